@@ -9,7 +9,9 @@ extern uint8_t g_buffer_end;
 extern void enable_UART_transmit(void);
 extern MSG_BUF* pcbs_in_state (int state);
 
-typedef enum {NEW = 0, RDY, RUN, BLK, WAIT} PROC_STATE_E;
+#define CRT_MAILBOX_LIMIT 16 /* print requests queued before their senders wait */
+
+typedef enum {NEW = 0, RDY, RUN, BLK, WAIT, WAIT_REPLY, BLK_SEND} PROC_STATE_E;
 
 char* nextNonWhitespace(char* cur) {
     for (int i = 0; cur[i] != '\0'; i++) {
@@ -41,72 +43,128 @@ char* copyStr(char* src, char* dest) {
     }
 }
 
+char* intToStr(int n, char* dest) {
+    char digits[10];
+    int count = 0;
+
+    if (n < 0) {
+        *dest++ = '-';
+        n = -n;
+    }
+    do {
+        digits[count++] = intToChar(n % 10);
+        n /= 10;
+    } while (n > 0);
+    while (count > 0) {
+        *dest++ = digits[--count];
+    }
+    *dest = '\0';
+    return dest;
+}
+
+char* padStr(char* dest, char* end, int width) {
+    while (end - dest < width) {
+        *end++ = ' ';
+    }
+    *end = '\0';
+    return end;
+}
+
 MSG_BUF* copyMessage(MSG_BUF* msg) {
     MSG_BUF* copy = (MSG_BUF*) request_memory_block();
     copyStr(msg->mtext, copy->mtext);
     return copy;
 }
 
+/**
+ * Prints a line per process with mailbox traffic, one block per line so
+ * a long table never overruns a block. Needs a kernel built with
+ * DEBUG_MAILBOX.
+ */
+void printMailboxStats() {
+    MAILBOX_STATS stats;
+    MSG_BUF* line = (MSG_BUF*) request_memory_block();
+
+    if (get_mailbox_stats(0, &stats) == RTX_ERR) {
+        copyStr("Mailbox stats need DEBUG_MAILBOX\r\n", line->mtext);
+        send_message(PID_CRT, (void*) line);
+        return;
+    }
+    copyStr("PID  SENT    RECV    DEPTH AVG(us) MAX(us)\r\n", line->mtext);
+    send_message(PID_CRT, (void*) line);
 
+    for (int pid = PID_NULL; pid <= PID_UART_IPROC; pid++) {
+        char* cur;
 
+        get_mailbox_stats(pid, &stats);
+        if (stats.sent == 0 && stats.received == 0) {
+            continue;
+        }
+        line = (MSG_BUF*) request_memory_block();
+        cur = line->mtext;
+        cur = padStr(cur, intToStr(pid, cur), 5);
+        cur = padStr(cur, intToStr(stats.sent, cur), 8);
+        cur = padStr(cur, intToStr(stats.received, cur), 8);
+        cur = padStr(cur, intToStr(stats.max_depth, cur), 6);
+        cur = padStr(cur, intToStr(stats.avg_latency, cur), 8);
+        cur = intToStr(stats.max_latency, cur);
+        copyStr("\r\n", cur);
+        send_message(PID_CRT, (void*) line);
+    }
+}
 
+/**
+ * Commands go out on the kernel topic named by their first two characters,
+ * e.g. "%W", so every process subscribed to it gets them. KCD_REG messages
+ * still subscribe their sender for processes that register that way.
+ */
 void kcdProc() {
-    const int maxNumIdentifiers = 16;
-    char identifiers[maxNumIdentifiers];
-    int processes[maxNumIdentifiers];
-    int numIdentifiers = 0;
+    char topic[3] = "%?";
 
     while (1) {
         int sender_id;
         MSG_BUF* msg = (MSG_BUF*) receive_message(&sender_id);
 				
         if (msg->mtype == KCD_REG) {
-            if (numIdentifiers < maxNumIdentifiers) {
-                identifiers[numIdentifiers] = msg->mtext[1]; // msg->mtext[0] == '%', msg->mtext[2] == '\0'
-                processes[numIdentifiers] = sender_id;
-
-                numIdentifiers++;
-            }
-						if (msg == NULL) {
-							uart1_put_string("msg == NULL");
-						}
+            topic[1] = msg->mtext[1]; // msg->mtext[0] == '%', msg->mtext[2] == '\0'
+            subscribe(topic, sender_id);
             release_memory_block((void*) msg);
         }
 				else if (msg->mtype == ECHO) {
 					send_message(PID_CRT, (void*) msg);
 				}
         else {
-            int recv_id = -1;
-            if (msg->mtext[0] == '%') {
-                for (int i = 0; i < numIdentifiers; i++) {
-                    if (identifiers[i] == msg->mtext[1]) {
-                        recv_id = processes[i];
-                        break;
-                    }
-                }
+            char hotkey = msg->mtext[0];
+            int published = RTX_ERR;
+
+            if (hotkey == '%' && msg->mtext[1] != '\0') {
+                topic[1] = msg->mtext[1];
+                msg->mtype = DEFAULT;
+                published = publish(topic, (void*) msg);
             }
-						
-            if (recv_id == -1) {
+            if (published == RTX_ERR) {
                 release_memory_block((void*) msg);
             }
-            else {
-                msg->mtype = DEFAULT;
-
-                send_message(recv_id, (void*) msg);
-            }
 						
-						if (msg->mtext[0] == '!') {
+						if (hotkey == '!') {
 							MSG_BUF* msg2 = pcbs_in_state(RDY);
 							send_message(PID_CRT, (void*) msg2);
 						}
-						else if (msg->mtext[0] == '@') {
+						else if (hotkey == '@') {
 							MSG_BUF* msg2 = pcbs_in_state(BLK);
 							send_message(PID_CRT, (void*) msg2);
 						}
-						else if (msg->mtext[0] == '#') {
+						else if (hotkey == '#') {
 							MSG_BUF* msg2 = pcbs_in_state(WAIT);
 							send_message(PID_CRT, (void*) msg2);
 						}
+						else if (hotkey == '$') {
+							MSG_BUF* msg2 = pcbs_in_state(WAIT_REPLY);
+							send_message(PID_CRT, (void*) msg2);
+						}
+						else if (hotkey == '^') {
+							printMailboxStats();
+						}
         }
     }
 }
@@ -120,6 +178,9 @@ void copyToBuffer(char* string) {
 
 
 void crtProc() {
+    // producers wait for the UART rather than fill the heap with output
+    set_mailbox_limit(PID_CRT, CRT_MAILBOX_LIMIT);
+
     while (1) {
         int sender_id;
         MSG_BUF *msg = (MSG_BUF *) receive_message(&sender_id);
@@ -0,0 +1,41 @@
+/**
+ * @file:   LPC17xx.h
+ * @brief:  host stand-in for the device header, just enough for timer.c to
+ *          build with gcc for timer_wheel_test.c. Not part of the Keil build.
+ */
+
+#ifndef LPC17XX_HOST_H_
+#define LPC17XX_HOST_H_
+
+#include <stdint.h>
+
+typedef enum {
+	TIMER0_IRQn = 1,
+	TIMER1_IRQn = 2
+} IRQn_Type;
+
+typedef struct {
+	volatile uint32_t IR, TCR, TC, PR, PC, MCR, MR0, MR1, MR2, MR3;
+} LPC_TIM_TypeDef;
+
+typedef struct {
+	volatile uint32_t PCONP, PCLKSEL0;
+} LPC_SC_TypeDef;
+
+/* registers the test reads and writes instead of the hardware */
+extern LPC_TIM_TypeDef host_tim0, host_tim1;
+extern LPC_SC_TypeDef host_sc;
+#define LPC_TIM0 (&host_tim0)
+#define LPC_TIM1 (&host_tim1)
+#define LPC_SC   (&host_sc)
+
+extern uint32_t SystemFrequency;
+
+/* no interrupts on the host, masking them does nothing */
+static inline uint32_t __get_PRIMASK(void) { return 0; }
+static inline void __set_PRIMASK(uint32_t primask) { (void) primask; }
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+static inline void NVIC_EnableIRQ(IRQn_Type irq) { (void) irq; }
+
+#endif /* LPC17XX_HOST_H_ */
@@ -0,0 +1,193 @@
+/**
+ * @file:   timer_wheel_test.c
+ * @brief:  host test of the timing wheel in timer.c. Random delayed messages,
+ *          some beyond the span of the wheel, some already due and some across
+ *          the 32-bit wrap of the tick count, must each go out on exactly the
+ *          tick they are due, or within their slack. Not part of the Keil build.
+ *          From src/:
+ *
+ *          gcc -std=gnu99 -DHOST_TEST -Ihost -I. -include k_process.h \
+ *              -o timer_wheel_test host/timer_wheel_test.c timer.c
+ *          ./timer_wheel_test
+ *
+ *          k_process.h goes first so PCBQ is complete where k_message.h
+ *          declares ReadyPQ, gcc insists on that and armcc does not.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <LPC17xx.h>
+#include "timer.h"
+
+#define NUM_MESSAGES 40000
+#define START_TICK   0xFFFF0000u /* 65536 ticks before the tick count wraps */
+
+/* A delayed message and the ticks it may go out on */
+typedef struct testMsg testMsg;
+struct testMsg {
+	envelope env;    /* must come first, the timer hands it back */
+	uint32_t first;  /* earliest tick it may go out on */
+	uint32_t last;   /* latest, first unless it has slack */
+	int handle;      /* -1 while not pending */
+};
+
+LPC_TIM_TypeDef host_tim0, host_tim1;
+LPC_SC_TypeDef host_sc;
+uint32_t SystemFrequency = 100000000;
+
+extern volatile uint32_t g_timer_count;
+extern volatile uint32_t g_timer_count_hi;
+extern uint32_t wheel_next;
+extern void c_TIMER0_IRQHandler(void);
+
+testMsg msgs[NUM_TIMERS];
+testMsg spare;
+int added = 0;
+int sent = 0;
+int cancelled = 0;
+int failures = 0;
+
+/**
+ * @brief: reports a failed check, the first few in full
+ */
+void fail(const char* what, testMsg* msg)
+{
+	if (failures++ < 10) {
+		printf("tick %08x: %s, due %08x to %08x\n", (unsigned) g_timer_count, what, (unsigned) msg->first, (unsigned) msg->last);
+	}
+}
+
+/* ---- what timer.c calls outside itself ---- */
+
+int timer_send_message(int process_id, envelope* env)
+{
+	testMsg* msg = (testMsg*) env;
+
+	if (msg->handle == -1) {
+		fail("sent a message that was not pending", msg);
+		return RTX_OK;
+	}
+	if (g_timer_count - msg->first > msg->last - msg->first) {
+		fail("sent on the wrong tick", msg);
+	}
+	if (timer_lookup(msg->handle) != NULL) {
+		fail("handle still valid once sent", msg);
+	}
+	msg->handle = -1;
+	sent++;
+	return RTX_OK;
+}
+
+void timedWaitTick(uint32_t now) {}
+int exists_higher_priority_ready_process(void) { return 0; }
+int k_release_processor(void) { return RTX_OK; }
+
+/**
+ * @brief: schedules msg with a random delay and slack, the way
+ *         delayed_send_at would
+ */
+void addRandom(testMsg* msg)
+{
+	uint32_t now = g_timer_count;
+	uint32_t deadline;
+	uint32_t slack = rand() % 4 == 0 ? rand() % 64 : 0;
+	int kind = rand() % 64;
+
+	if (kind == 0) {
+		deadline = now + rand() % (2 * WHEEL_RANGE);  // parked beyond the wheel
+	}
+	else if (kind == 1) {
+		deadline = now - rand() % 100;                 // already due
+	}
+	else {
+		deadline = now + rand() % 2048;
+	}
+
+	//anything not after now goes out on the next tick
+	msg->first = TIME_AFTER(deadline, now) ? deadline : now + 1;
+	msg->last = TIME_AFTER(deadline + slack, now) ? deadline + slack : now + 1;
+	msg->handle = timer_add(&msg->env, 1, deadline, slack);
+	if (msg->handle == RTX_ERR) {
+		msg->handle = -1;
+		fail("no timer free", msg);
+		return;
+	}
+	added++;
+}
+
+/**
+ * @brief: takes back a random pending message
+ */
+void cancelRandom(void)
+{
+	testMsg* msg = &msgs[rand() % NUM_TIMERS];
+	timerEntry* entry;
+
+	if (msg->handle == -1) {
+		return;
+	}
+	entry = timer_lookup(msg->handle);
+	if (entry == NULL || timer_cancel(entry) != &msg->env) {
+		fail("could not cancel", msg);
+		return;
+	}
+	if (timer_lookup(msg->handle) != NULL) {
+		fail("handle still valid once cancelled", msg);
+	}
+	msg->handle = -1;
+	cancelled++;
+}
+
+int main(void)
+{
+	int i;
+	int pending;
+	uint32_t ticks = 0;
+
+	srand(350);
+	timer_init(0);
+	g_timer_count = START_TICK;
+	wheel_next = START_TICK;
+
+	for (i = 0; i < NUM_TIMERS; i++) {
+		msgs[i].handle = -1;
+	}
+
+	while (sent + cancelled < NUM_MESSAGES) {
+		//keep the pool full
+		for (i = 0; i < NUM_TIMERS; i++) {
+			if (msgs[i].handle == -1 && added < NUM_MESSAGES) {
+				addRandom(&msgs[i]);
+				if (rand() % 32 == 0) {
+					cancelRandom();
+				}
+			}
+		}
+		pending = 0;
+		for (i = 0; i < NUM_TIMERS; i++) {
+			if (msgs[i].handle != -1) {
+				pending++;
+				if (TIME_AFTER(g_timer_count, msgs[i].last)) {
+					fail("never sent", &msgs[i]);
+					msgs[i].handle = -1;
+					cancelled++;
+				}
+			}
+		}
+		if (pending == NUM_TIMERS && timer_add(&spare.env, 1, g_timer_count + 1, 0) != RTX_ERR) {
+			fail("added past NUM_TIMERS", &spare);
+		}
+
+		//the tick, as TIMER0 raises it
+		LPC_TIM0->IR = 1;
+		c_TIMER0_IRQHandler();
+		ticks++;
+	}
+
+	if (g_timer_count_hi == 0) {
+		printf("the tick count never wrapped\n");
+		failures++;
+	}
+	printf("%d sent, %d cancelled, over %u ticks: %s\n", sent, cancelled, (unsigned) ticks, failures == 0 ? "passed" : "FAILED");
+	return failures != 0;
+}
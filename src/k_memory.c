@@ -8,6 +8,8 @@
 #include "k_memory.h"
 #include "k_process.h"
 #include "k_message.h"
+#include "timer.h"
+#include "rtc.h"
 #ifdef DEBUG_MEM
 #include "uart_polling.h"
 #endif
@@ -20,8 +22,11 @@ U32 *gp_stack; /* The last allocated stack low address. 8 bytes aligned */
                /* The first stack starts at the RAM high address */
          /* stack grows down. Fully decremental stack */
 U8 *p_end;
-MemQueue memQueue;
+MemStack memStack;
 unsigned int numOfBlocks;
+unsigned int numFreeBlocks;
+int memReserve[NUM_PROCS]; /* blocks held back for each process */
+int memReserved;           /* sum of memReserve[] */
 
 
 /**
@@ -60,7 +65,7 @@ unsigned int numOfBlocks;
 
 int getNumFreeBlocks() {
 	int count = 0;
-	for (MemBlock* cur = memQueue.head; cur != NULL; cur = cur->next) {
+	for (MemBlock* cur = memStack.top; cur != NULL; cur = cur->next) {
 		count++;
 	}
 	return count;
@@ -101,13 +106,14 @@ void memory_init(void)
 
 // maps the memory blocks in the heap so that each of them point to the next, and correspond to the defined BLOCK_SIZE
 void heap_init() {
+  int i;
   U32 block_head;
   MemBlock* memBlock;
   MemBlock* lastBlock;
 
-  memQueue.head = (MemBlock*) p_end;
+  memStack.top = (MemBlock*) p_end;
   numOfBlocks = 0;
-  for (block_head = (U32) memQueue.head; block_head + BLOCK_SIZE < (U32) gp_stack; block_head += BLOCK_SIZE) {
+  for (block_head = (U32) memStack.top; block_head + BLOCK_SIZE < (U32) gp_stack; block_head += BLOCK_SIZE) {
       memBlock = (MemBlock*) block_head;
       memBlock->next = (MemBlock*) (block_head + BLOCK_SIZE);
       numOfBlocks++;
@@ -115,7 +121,80 @@ void heap_init() {
   lastBlock = (MemBlock*) (block_head - BLOCK_SIZE);
   lastBlock->next = NULL;
 
-  memQueue.tail = lastBlock;
+  numFreeBlocks = numOfBlocks;
+
+  for (i = 0; i < NUM_PROCS; i++) {
+    memReserve[i] = 0;
+  }
+  memReserved = 0;
+  set_memory_reserve(PID_UART_IPROC, UART_IPROC_RESERVED_BLOCKS);
+  set_memory_reserve(PID_CLOCK, RTC_RESERVED_BLOCKS);
+}
+
+/**
+ * @brief: holds num_blocks blocks of the heap back for process pid. Other
+ *         processes can not allocate those blocks, so pid keeps getting memory
+ *         even after the rest of the heap has been exhausted.
+ * @return: RTX_ERR if the reserves would exceed the heap, RTX_OK otherwise
+ */
+int set_memory_reserve(int pid, int num_blocks)
+{
+  if (pid < 0 || pid >= NUM_PROCS || num_blocks < 0 ||
+      memReserved - memReserve[pid] + num_blocks > numOfBlocks) {
+    return RTX_ERR;
+  }
+  memReserved += num_blocks - memReserve[pid];
+  memReserve[pid] = num_blocks;
+  return RTX_OK;
+}
+
+/**
+ * @brief: checks that the block is BLOCK_SIZE-aligned and between start and end of the PCBS and start of the stack
+ */
+int isHeapBlock(void* p_blk)
+{
+  return p_end <= p_blk && p_blk < gp_stack && ((U32)p_blk - (U32)p_end) % BLOCK_SIZE == 0;
+}
+
+/**
+ * @brief: pops a block off memStack on behalf of pid, without touching the
+ *         blocks other processes have reserved
+ * @return: the block, or NULL if none is available to pid
+ */
+MemBlock* popMemBlock(int pid)
+{
+  MemBlock* block = NULL;
+  U32 primask = __get_PRIMASK();
+
+  __disable_irq();
+  if (numFreeBlocks > memReserved - memReserve[pid]) {
+    block = memStack.top;
+    memStack.top = block->next;
+    numFreeBlocks--;
+  }
+  __set_PRIMASK(primask);
+
+  if (block != NULL) {
+    ((envelope*) block)->refs = 1;
+    ((envelope*) block)->length = ENV_LEN_TEXT;
+    ((envelope*) block)->flags = 0;
+  }
+
+  return block;
+}
+
+/**
+ * @brief: pushes a block onto memStack
+ */
+void pushMemBlock(MemBlock* block)
+{
+  U32 primask = __get_PRIMASK();
+
+  __disable_irq();
+  block->next = memStack.top;
+  memStack.top = block;
+  numFreeBlocks++;
+  __set_PRIMASK(primask);
 }
 
 /**
@@ -155,21 +234,12 @@ void *k_request_memory_block(void) {
   printf("k_request_memory_block: entering...\n");
 #endif /* ! DEBUG_0 */
   
+	MemBlock* prevHead;
 
-  while (memQueue.head == NULL) {
+  while ((prevHead = popMemBlock(gp_current_process->m_pid)) == NULL) {
     makeBlock();
   }
 	
-	MemBlock* prevHead = memQueue.head;
-
-  if (memQueue.head == memQueue.tail) {
-    memQueue.tail = NULL;
-    memQueue.head = NULL;
-  }
-  else {
-    memQueue.head = memQueue.head->next;
-  }
-	
 #ifdef DEBUG_MEM
 	uart1_put_string("Blocks remaining req_after: ");
 	n = getNumFreeBlocks();
@@ -183,6 +253,12 @@ void *k_request_memory_block(void) {
 }
 
 void *k_request_memory_block_non_blocking(void) {
+  return k_request_memory_block_reserved(gp_current_process->m_pid);
+}
+
+// like k_request_memory_block_non_blocking, but may dip into the reserve of pid. Used by i-processes,
+// which run on top of whichever process they interrupted
+void *k_request_memory_block_reserved(int pid) {
   
 
 #ifdef DEBUG_MEM
@@ -198,18 +274,10 @@ void *k_request_memory_block_non_blocking(void) {
   printf("k_request_memory_block_non_blocking: entering...\n");
 #endif /* ! DEBUG_0 */
 
-  if (memQueue.head == NULL) {
-    return NULL;
-  }
-	
-	MemBlock* prevHead = memQueue.head;
+	MemBlock* prevHead = popMemBlock(pid);
 	
-  if (memQueue.head == memQueue.tail) {
-    memQueue.tail = NULL;
-    memQueue.head = NULL;
-  }
-  else {
-    memQueue.head = memQueue.head->next;
+  if (prevHead == NULL) {
+    return NULL;
   }
 	
 #ifdef DEBUG_MEM
@@ -224,12 +292,31 @@ void *k_request_memory_block_non_blocking(void) {
   return (void *) ((envelope*) prevHead + 1);
 }
 
-// adds the specified block back into the linked list of available memory blocks in the heap
+// like k_request_memory_block, but gives up and returns NULL once ticks TIMER0 ticks have passed
+void *k_request_memory_block_timeout(int ticks) {
+#ifdef DEBUG_0
+  printf("k_request_memory_block_timeout: entering...\n");
+#endif /* ! DEBUG_0 */
+
+	MemBlock* prevHead = popMemBlock(gp_current_process->m_pid);
+
+  if (prevHead == NULL && ticks > 0) {
+    timedWaitStart(get_time() + ticks);
+    do {
+      makeBlock();
+      prevHead = popMemBlock(gp_current_process->m_pid);
+    } while (prevHead == NULL && gp_current_process->m_timed_wait != TIMED_WAIT_EXPIRED);
+    timedWaitEnd();
+  }
+
+  if (prevHead == NULL) {
+    return NULL;
+  }
+  return (void *) ((envelope*) prevHead + 1);
+}
+
+// pushes the specified block back onto the stack of available memory blocks in the heap
 int k_release_memory_block(void *p_mem_blk) {
-  MemBlock * newTail;
-	
-	__disable_irq();
-	
 #ifdef DEBUG_MEM
 	uart1_put_string("Blocks remaining rel_before: ");
 	int n = getNumFreeBlocks();
@@ -240,6 +327,7 @@ int k_release_memory_block(void *p_mem_blk) {
 #endif
 	
 	void* orig_blk = p_mem_blk;
+	U32 primask;
 	
 	p_mem_blk = (void*) ((envelope*) p_mem_blk - 1);
 	
@@ -247,8 +335,7 @@ int k_release_memory_block(void *p_mem_blk) {
   printf("k_release_memory_block: releasing block @ 0x%x\n", p_mem_blk);
 #endif /* ! DEBUG_0 */
 
-	// check that the block is BLOCK_SIZE-aligned and between start and end of the PCBS and start of the stack
-  if (!(p_end <= p_mem_blk && p_mem_blk < gp_stack && ((U32)p_mem_blk - (U32)p_end) % BLOCK_SIZE == 0)) {
+  if (!isHeapBlock(p_mem_blk)) {
 #ifdef DEBUG_MEM
 		uart1_put_string("Blocks remaining rel_error: ");
 		n = getNumFreeBlocks();
@@ -258,24 +345,26 @@ int k_release_memory_block(void *p_mem_blk) {
 		uart1_put_string("\n\r");
 #endif
 		
-		__enable_irq();
 		return RTX_ERR;
   }
 
-  newTail = (MemBlock *) p_mem_blk;
-  newTail->next = NULL;
+  // the timer i-process moves processes between BlockPQ and ReadyPQ too
+  primask = __get_PRIMASK();
+  __disable_irq();
 
-  if (memQueue.tail != NULL) {
-    memQueue.tail->next = newTail;
-    memQueue.tail = newTail;
-  } else {
-    memQueue.head = newTail;
-    memQueue.tail = newTail;
+  // a shared block only goes back to the heap once its last receiver lets go
+  if (((envelope*) p_mem_blk)->refs > 1) {
+    ((envelope*) p_mem_blk)->refs--;
+    __set_PRIMASK(primask);
+    return RTX_OK;
   }
 
+  pushMemBlock((MemBlock *) p_mem_blk);
+
   if (!blockPQIsEmpty()) {
     makeReady();
   }
+  __set_PRIMASK(primask);
 	
 #ifdef DEBUG_MEM
 	uart1_put_string("Blocks remaining rel_after: ");
@@ -289,6 +378,5 @@ int k_release_memory_block(void *p_mem_blk) {
 	uart1_put_string("\n\r");
 #endif
 
-	__enable_irq();
   return RTX_OK;
 }
@@ -13,16 +13,19 @@
 /* ----- Definitions ----- */
 #define RAM_END_ADDR 0x10008000
 
+/* Blocks only the UART i-process may use, so keyboard input survives a memory hog */
+#define UART_IPROC_RESERVED_BLOCKS 8
+
 
 typedef struct MemBlock MemBlock;
 struct MemBlock {
     MemBlock* next;
 };
 
-typedef struct MemQueue MemQueue;
-struct MemQueue {
-    MemBlock* head;
-    MemBlock* tail;
+/* free blocks form a LIFO stack, so the most recently released block is reused first */
+typedef struct MemStack MemStack;
+struct MemStack {
+    MemBlock* top;
 };
 
 /* ----- Variables ----- */
@@ -30,8 +33,9 @@ struct MemQueue {
 extern unsigned int Image$$RW_IRAM1$$ZI$$Limit;
 extern PCB **gp_pcbs;
 extern PROC_INIT g_proc_table[NUM_TEST_PROCS];
-extern MemQueue memQueue;
+extern MemStack memStack;
 extern unsigned int numOfBlocks;
+extern unsigned int numFreeBlocks;
 
 /* ----- Functions ------ */
 void memory_init(void);
@@ -39,6 +43,10 @@ void heap_init(void);
 U32 *alloc_stack(U32 size_b);
 void *k_request_memory_block(void);
 void *k_request_memory_block_non_blocking(void);
+void *k_request_memory_block_timeout(int ticks);
+void *k_request_memory_block_reserved(int pid);
+int set_memory_reserve(int pid, int num_blocks);
+int isHeapBlock(void* p_blk);
 int k_release_memory_block(void *);
 
 #endif /* ! K_MEM_H_ */
@@ -2,12 +2,209 @@
 #include "k_rtx.h"
 #include "k_process.h"
 #include "timer.h"
+#include "k_memory.h"
 
 #ifdef DEBUG_MEM
 #include "uart_polling.h"
 #endif
 
-int k_send_message(int process_id, void* message_envelope) {
+msgAlias msgAliases[NUM_MSG_ALIASES];
+msgAlias* freeAliases = NULL;
+int numFreeAliases = 0;
+
+topic topics[NUM_TOPICS];
+
+#ifdef DEBUG_MAILBOX
+typedef struct mailboxCounter mailboxCounter;
+struct mailboxCounter {
+	int sent;
+	int received;
+	int max_depth;
+	uint32_t max_latency;   /* in cycles */
+	uint64_t total_latency;
+};
+mailboxCounter mailboxCounters[NUM_PROCS];
+#endif /* DEBUG_MAILBOX */
+
+/**
+ * @brief: puts all the aliases on the free list
+ */
+void message_init(void) {
+	int i;
+	freeAliases = NULL;
+	for (i = 0; i < NUM_MSG_ALIASES; i++) {
+		msgAliases[i].env.next = (envelope*) freeAliases;
+		freeAliases = &msgAliases[i];
+	}
+	numFreeAliases = NUM_MSG_ALIASES;
+	
+	for (i = 0; i < NUM_TOPICS; i++) {
+		topics[i].name[0] = '\0';
+		topics[i].subscribers = 0;
+	}
+	
+#ifdef DEBUG_MAILBOX
+	for (i = 0; i < NUM_PROCS; i++) {
+		mailboxCounters[i].sent = 0;
+		mailboxCounters[i].received = 0;
+		mailboxCounters[i].max_depth = 0;
+		mailboxCounters[i].max_latency = 0;
+		mailboxCounters[i].total_latency = 0;
+	}
+#endif /* DEBUG_MAILBOX */
+}
+
+/**
+ * @brief: checks whether env is an alias of a shared block rather than a block
+ */
+int isAlias(envelope* env) {
+	return (U32) env - (U32) msgAliases < sizeof(msgAliases);
+}
+
+/**
+ * @brief: appends env to the queue of the mailbox of thePCB its flags select
+ */
+void mailboxEnqueue(PCB* thePCB, envelope* env) {
+	int q = (env->flags & MSG_URGENT) ? MSG_QUEUE_URGENT : MSG_QUEUE_NORMAL;
+	
+	env->next = NULL;
+	if (thePCB->msgTail[q] == NULL) {
+		thePCB->msgHead[q] = env;
+		thePCB->msgTail[q] = env;
+	}
+	else {
+		thePCB->msgTail[q]->next = env;
+		thePCB->msgTail[q] = env;
+	}
+	thePCB->m_msg_count++;
+	
+#ifdef DEBUG_MAILBOX
+	env->stamp = (unsigned int) clock_cycles();
+	mailboxCounters[env->sender_id].sent++;
+	if (thePCB->m_msg_count > mailboxCounters[thePCB->m_pid].max_depth) {
+		mailboxCounters[thePCB->m_pid].max_depth = thePCB->m_msg_count;
+	}
+#endif /* DEBUG_MAILBOX */
+}
+
+/**
+ * @brief: unlinks env from queue q of the mailbox of thePCB, prev is the
+ *         envelope before it or NULL if env is at the head
+ */
+void mailboxRemove(PCB* thePCB, int q, envelope* prev, envelope* env) {
+	if (prev == NULL) {
+		thePCB->msgHead[q] = env->next;
+	}
+	else {
+		prev->next = env->next;
+	}
+	if (thePCB->msgTail[q] == env) {
+		thePCB->msgTail[q] = prev;
+	}
+	thePCB->m_msg_count--;
+	
+	if (!queueIsEmpty(SendPQ)) {
+		wakeSenders(thePCB);
+	}
+}
+
+/**
+ * @brief: removes the first envelope from the mailbox of thePCB, urgent
+ *         messages first
+ * @return: the envelope, or NULL if the mailbox is empty
+ */
+envelope* mailboxDequeue(PCB* thePCB) {
+	envelope* env;
+	int q;
+	
+	for (q = 0; q < MSG_QUEUES; q++) {
+		env = thePCB->msgHead[q];
+		if (env != NULL) {
+			mailboxRemove(thePCB, q, NULL, env);
+			return env;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief: whether n more messages would go over the mailbox limit of thePCB
+ */
+int mailboxFull(PCB* thePCB, int n) {
+	return thePCB->m_msg_limit != 0 && thePCB->m_msg_count + n > thePCB->m_msg_limit;
+}
+
+/**
+ * @brief: blocks the current process in BLK_SEND until the mailbox of thePCB
+ *         has room for n more messages. Kernel and i-process senders do not
+ *         call this, their messages always go through, and neither do
+ *         messages to self, nobody else would make room for them.
+ */
+void mailboxWaitForRoom(PCB* thePCB, int n) {
+	while (thePCB != gp_current_process && mailboxFull(thePCB, n)) {
+		gp_current_process->m_send_to = thePCB->m_pid;
+		gp_current_process->m_state = BLK_SEND;
+		k_release_processor();
+	}
+}
+
+int mailboxEmpty(PCB* thePCB) {
+	return thePCB->msgHead[MSG_QUEUE_URGENT] == NULL && thePCB->msgHead[MSG_QUEUE_NORMAL] == NULL;
+}
+
+/**
+ * @brief: puts env in the mailbox of thePCB and readies thePCB if it was waiting
+ * @return: 1 if thePCB was readied, 0 otherwise
+ */
+int deliverMessage(PCB* thePCB, envelope* env) {
+	mailboxEnqueue(thePCB, env);
+	
+	// set to ready if not blocked on memory
+	if (thePCB->m_state == WAIT){
+		processEnqueue(ReadyPQ, thePCB);
+		thePCB->m_state = RDY;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief: turns a dequeued envelope into the message handed to the receiver.
+ *         Aliases go back on the free list and yield the shared block.
+ *         Urgency is not kept, a message sent on is normal unless resent urgent.
+ */
+void* envelopeToMessage(envelope* env) {
+	msgAlias* alias;
+	
+#ifdef DEBUG_MAILBOX
+	mailboxCounter* counter = &mailboxCounters[gp_current_process->m_pid];
+	uint32_t latency = (unsigned int) clock_cycles() - env->stamp;
+	
+	counter->received++;
+	counter->total_latency += latency;
+	if (latency > counter->max_latency) {
+		counter->max_latency = latency;
+	}
+#endif /* DEBUG_MAILBOX */
+	
+	if (env->flags & MSG_NOTIFY) {
+		gp_pcbs[env->sender_id]->m_delivered++;
+	}
+	if (isAlias(env)) {
+		alias = (msgAlias*) env;
+		env = alias->target;
+		alias->env.next = (envelope*) freeAliases;
+		freeAliases = alias;
+		numFreeAliases++;
+	}
+	env->flags &= ~(MSG_URGENT | MSG_NOTIFY);
+	return (void*) (env + 1);
+}
+
+/**
+ * @brief: sends a message with the given envelope flags, see k_send_message
+ */
+int sendMessage(int process_id, void* message_envelope, int flags) {
 	
 	PCB* thePCB;
 	envelope* env;
@@ -21,28 +218,27 @@ int k_send_message(int process_id, void* message_envelope) {
 	#endif
 	
 	env = (envelope*) message_envelope - 1;
-	env->next = NULL;
-	env->sender_id = gp_current_process->m_pid;
-	env->recv_id = process_id;
-	
-	thePCB = gp_pcbs[env->recv_id];
-	
-	if (thePCB->msgTail == NULL) {
-		thePCB->msgHead = env;
-		thePCB->msgTail = env;
+	if (env->refs > 1) {
+		return RTX_ERR; // shared blocks are read-only
 	}
-	else {
-		thePCB->msgTail->next = env;
-		thePCB->msgTail = env;
-	}
-	
-	// preemption if blocked on receive and high priority
-	// set to ready if not blocked on memory
+	thePCB = gp_pcbs[process_id];
+	mailboxWaitForRoom(thePCB, 1);
 	
-	if (thePCB->m_state == WAIT){
-		processEnqueue(ReadyPQ, thePCB);
+	env->sender_id = gp_current_process->m_pid;
+	env->flags |= flags;
+	
+	// a waiting receiver with a better priority runs next, switch to it directly.
+	// send_message_async can leave a process ready that beats the sender, so
+	// the receiver has to beat ReadyPQ as well.
+	if (thePCB->m_state == WAIT && thePCB->m_priority < gp_current_process->m_priority
+			&& !exists_ready_process_above(thePCB->m_priority)){
+		mailboxEnqueue(thePCB, env);
 		thePCB->m_state = RDY;
-		if (thePCB->m_priority < gp_current_process->m_priority){
+		process_handoff(thePCB);
+	}
+	else {
+		deliverMessage(thePCB, env);
+		if (exists_higher_priority_ready_process()) {
 			k_release_processor();
 		}
 	}
@@ -51,24 +247,277 @@ int k_send_message(int process_id, void* message_envelope) {
 	
 }
 
+int k_send_message(int process_id, void* message_envelope) {
+	return sendMessage(process_id, message_envelope, 0);
+}
+
+/**
+ * @brief: like k_send_message, but the receiver gets the message before any
+ *         normal message already in its mailbox
+ */
+int k_send_message_urgent(int process_id, void* message_envelope) {
+	return sendMessage(process_id, message_envelope, MSG_URGENT);
+}
+
+/**
+ * @brief: like k_send_message, but fails instead of waiting when the mailbox
+ *         of process_id is full
+ * @return: RTX_ERR if the mailbox is full, RTX_OK otherwise
+ */
+int k_try_send_message(int process_id, void* message_envelope) {
+	if (process_id < 0 || process_id >= NUM_PROCS || mailboxFull(gp_pcbs[process_id], 1)) {
+		return RTX_ERR;
+	}
+	return sendMessage(process_id, message_envelope, 0);
+}
+
+/**
+ * @brief: queues a message without giving up the processor, even to a better
+ *         receiver it wakes. The caller picks when to switch, e.g. with
+ *         release_processor() after a run of sends. If notify is set, the
+ *         caller's delivered count goes up once the receiver takes it.
+ * @return: RTX_ERR if process_id is invalid, the block is shared or the
+ *          mailbox is full, RTX_OK otherwise
+ */
+int k_send_message_async(int process_id, void* message_envelope, int notify) {
+	envelope* env = (envelope*) message_envelope - 1;
+	
+	if (process_id < 0 || process_id >= PID_TIMER_IPROC || env->refs > 1 ||
+	    mailboxFull(gp_pcbs[process_id], 1)) {
+		return RTX_ERR;
+	}
+	env->sender_id = gp_current_process->m_pid;
+	if (notify) {
+		env->flags |= MSG_NOTIFY;
+	}
+	deliverMessage(gp_pcbs[process_id], env);
+	return RTX_OK;
+}
+
+/**
+ * @brief: how many of the caller's send_message_async(..., 1) messages have
+ *         been received so far
+ */
+int k_get_delivered_count(void) {
+	return gp_current_process->m_delivered;
+}
+
+/**
+ * @brief: copies the mailbox traffic of process_id into stats, latencies in
+ *         microseconds
+ * @return: RTX_ERR if process_id is invalid or the kernel was built without
+ *          DEBUG_MAILBOX, RTX_OK otherwise
+ */
+int k_get_mailbox_stats(int process_id, MAILBOX_STATS* stats) {
+#ifdef DEBUG_MAILBOX
+	mailboxCounter* counter;
+	
+	if (process_id < 0 || process_id >= NUM_PROCS) {
+		return RTX_ERR;
+	}
+	counter = &mailboxCounters[process_id];
+	stats->sent = counter->sent;
+	stats->received = counter->received;
+	stats->max_depth = counter->max_depth;
+	stats->avg_latency = counter->received == 0 ? 0 : (int) clock_cycles_to_us(counter->total_latency / counter->received);
+	stats->max_latency = (int) clock_cycles_to_us(counter->max_latency);
+	return RTX_OK;
+#else
+	return RTX_ERR;
+#endif /* DEBUG_MAILBOX */
+}
+
+/**
+ * @brief: a receive may have readied a sender waiting for room, let it run if
+ *         it beats the receiver
+ */
+void yieldToSenders(void) {
+	if (exists_higher_priority_ready_process()) {
+		k_release_processor();
+	}
+}
+
 void* k_receive_message(int* sender_id) {
 	PCB* thePCB = gp_current_process;
-	while (thePCB->msgHead == NULL) {
+	void* message;
+	while (mailboxEmpty(thePCB)) {
 		thePCB->m_state = WAIT;
 		k_release_processor();
 	}
 	
-	envelope* envelope = thePCB->msgHead;
-	
-	if (thePCB->msgHead == thePCB->msgTail) {
-    thePCB->msgHead = NULL;
-    thePCB->msgTail = NULL;
-  }
-  else {
-    thePCB->msgHead = thePCB->msgHead->next;
-  }
+	envelope* envelope = mailboxDequeue(thePCB);
 	*sender_id = envelope->sender_id;
-	return (void*) (envelope + 1);
+	message = envelopeToMessage(envelope);
+	yieldToSenders();
+	return message;
+}
+
+/**
+ * @brief: the body of the message env carries, looking through aliases
+ */
+MSG_BUF* envelopeBody(envelope* env) {
+	if (isAlias(env)) {
+		env = ((msgAlias*) env)->target;
+	}
+	return (MSG_BUF*) (env + 1);
+}
+
+/**
+ * @brief: like k_receive_message, but only takes a message of type mtype from
+ *         sender, either of which may be ANY_TYPE/ANY_SENDER. Other messages
+ *         stay in the mailbox, in order, for later receives.
+ */
+void* k_receive_message_filtered(int* sender_id, int mtype, int sender) {
+	PCB* thePCB = gp_current_process;
+	envelope* prev[MSG_QUEUES]; // last envelope of each queue that did not match
+	envelope* env = NULL;
+	void* message;
+	int q;
+	
+	for (q = 0; q < MSG_QUEUES; q++) {
+		prev[q] = NULL;
+	}
+	
+	while (1) {
+		for (q = 0; q < MSG_QUEUES; q++) {
+			env = prev[q] == NULL ? thePCB->msgHead[q] : prev[q]->next;
+			
+			while (env != NULL) {
+				if ((sender == ANY_SENDER || env->sender_id == sender) &&
+				    (mtype == ANY_TYPE || envelopeBody(env)->mtype == mtype)) {
+					break;
+				}
+				prev[q] = env;
+				env = env->next;
+			}
+			if (env != NULL) {
+				break;
+			}
+		}
+		if (env != NULL) {
+			break;
+		}
+		
+		// only new messages can match, the scan resumes after prev
+		thePCB->m_state = WAIT;
+		k_release_processor();
+	}
+	
+	mailboxRemove(thePCB, q, prev[q], env);
+	*sender_id = env->sender_id;
+	message = envelopeToMessage(env);
+	yieldToSenders();
+	return message;
+}
+
+/**
+ * @brief: like k_receive_message, but gives up once ticks TIMER0 ticks have
+ *         passed. The timer i-process ends the wait, no message is spent on it.
+ * @return: the message, or NULL on timeout, in which case sender_id is untouched
+ */
+void* k_receive_message_timeout(int* sender_id, int ticks) {
+	PCB* thePCB = gp_current_process;
+	envelope* env;
+	void* message;
+	
+	if (mailboxEmpty(thePCB) && ticks > 0) {
+		timedWaitStart(get_time() + ticks);
+		do {
+			thePCB->m_state = WAIT;
+			k_release_processor();
+		} while (mailboxEmpty(thePCB) && thePCB->m_timed_wait != TIMED_WAIT_EXPIRED);
+		timedWaitEnd();
+	}
+	
+	env = mailboxDequeue(thePCB);
+	if (env == NULL) {
+		return NULL;
+	}
+	*sender_id = env->sender_id;
+	message = envelopeToMessage(env);
+	yieldToSenders();
+	return message;
+}
+
+/**
+ * @brief: sends a request to process_id and waits for its reply(). If the
+ *         server is waiting for a message and nothing better is ready, the
+ *         kernel switches to it directly instead of going through ReadyPQ.
+ * @return: the reply, or NULL if the request can not be sent
+ */
+void* k_send_receive(int process_id, void* message_envelope) {
+	PCB* client = gp_current_process;
+	PCB* server;
+	envelope* env;
+	
+	if (process_id < 0 || process_id >= PID_TIMER_IPROC || process_id == client->m_pid) {
+		return NULL;
+	}
+	env = (envelope*) message_envelope - 1;
+	if (env->refs > 1) {
+		return NULL; // shared blocks are read-only
+	}
+	server = gp_pcbs[process_id];
+	mailboxWaitForRoom(server, 1);
+	
+	env->sender_id = client->m_pid;
+	
+	client->m_reply = NULL;
+	client->m_reply_from = process_id;
+	client->m_state = WAIT_REPLY;
+	
+	if (server->m_state == WAIT && !exists_ready_process_above(server->m_priority)) {
+		mailboxEnqueue(server, env);
+		server->m_state = RDY;
+		process_handoff(server);
+	}
+	else {
+		deliverMessage(server, env);
+	}
+	
+	while (client->m_reply == NULL) {
+		client->m_state = WAIT_REPLY;
+		k_release_processor();
+	}
+	
+	env = client->m_reply;
+	client->m_reply = NULL;
+	client->m_reply_from = -1;
+	return (void*) (env + 1);
+}
+
+/**
+ * @brief: answers the send_receive process_id is waiting in. The client runs
+ *         next, without a pass through the scheduler, unless the caller or
+ *         another ready process has a better priority.
+ * @return: RTX_ERR if process_id is not waiting on the caller, RTX_OK otherwise
+ */
+int k_reply(int process_id, void* message_envelope) {
+	PCB* client;
+	envelope* env;
+	
+	if (process_id < 0 || process_id >= NUM_PROCS) {
+		return RTX_ERR;
+	}
+	client = gp_pcbs[process_id];
+	env = (envelope*) message_envelope - 1;
+	if (env->refs > 1 || client->m_state != WAIT_REPLY || client->m_reply_from != gp_current_process->m_pid) {
+		return RTX_ERR;
+	}
+	env->sender_id = gp_current_process->m_pid;
+	
+	client->m_reply = env;
+	client->m_state = RDY;
+	if (client->m_priority <= gp_current_process->m_priority && !exists_ready_process_above(client->m_priority)) {
+		process_handoff(client);
+	}
+	else {
+		processEnqueue(ReadyPQ, client);
+		if (exists_higher_priority_ready_process()) {
+			k_release_processor();
+		}
+	}
+	return RTX_OK;
 }
 
 int k_send_message_non_preempt(int process_id, void* message_envelope) {
@@ -85,101 +534,464 @@ int k_send_message_non_preempt(int process_id, void* message_envelope) {
 	envelope* env;
 	
 	env = (envelope*) message_envelope - 1;
-	env->next = NULL;
+	if (env->refs > 1) {
+		return RTX_ERR; // shared blocks are read-only
+	}
 	env->sender_id = gp_current_process->m_pid;
-	env->recv_id = process_id;
 	
-	thePCB = gp_pcbs[env->recv_id];
+	thePCB = gp_pcbs[process_id];
+	
+	deliverMessage(thePCB, env);
 	
-	if (thePCB->msgTail == NULL) {
-		thePCB->msgHead = env;
-		thePCB->msgTail = env;
+	return RTX_OK;
+	
+}
+
+int timer_send_message(int process_id, envelope* env) {
+	
+	deliverMessage(gp_pcbs[process_id], env);
+	
+	return RTX_OK;
+	
+}
+
+envelope* k_receive_message_non_blocking(int proc_id) {
+	return mailboxDequeue(gp_pcbs[proc_id]);
+}
+
+/*int k_has_message(int process_id) {
+	PCB* thePCB = gp_pcbs[process_id];;
+	if (mailboxEmpty(thePCB)) {
+		return 0;
 	}
-	else {
-		thePCB->msgTail->next = env;
-		thePCB->msgTail = env;
+	
+	return 1;
+}*/
+
+int k_delayed_send(int process_id, void* message_envelope, int delay) {
+	return k_delayed_send_at(process_id, message_envelope, get_time() + delay);
+}
+
+/**
+ * @brief: sends a message once the clock reaches send_time. Periodic senders can
+ *         add their period to the previous send_time and never drift.
+ *         A send_time in the past goes out on the next tick.
+ * @return: a handle for cancel_delayed_send and rearm_delayed_send, or RTX_ERR
+ *          if all NUM_TIMERS are in use
+ */
+int k_delayed_send_at(int process_id, void* message_envelope, int send_time) {
+	
+	envelope* env;
+	int handle;
+	U32 primask;
+	
+	env = (envelope*) message_envelope - 1;
+	if (env->refs > 1) {
+		return RTX_ERR; // shared blocks are read-only
 	}
+	env->sender_id = gp_current_process->m_pid;
 	
-	// set to ready if not blocked on memory
+	// straight into the timing wheel, the timer i-process only has to expire it
+	primask = __get_PRIMASK();
+	__disable_irq();
+	handle = timer_add(env, process_id, send_time, gp_current_process->m_timer_slack);
+	__set_PRIMASK(primask);
+	//No need for pre-emption
+	return handle;
+}
+
+/**
+ * @brief: sends a message delay_us microseconds from now. Delays are kept to
+ *         the microsecond by a TIMER0 match instead of rounding to the tick.
+ * @return: a handle for cancel_delayed_send and rearm_delayed_send, or RTX_ERR
+ *          if all NUM_TIMERS are in use
+ */
+int k_delayed_send_us(int process_id, void* message_envelope, int delay_us) {
 	
-	if (thePCB->m_state == WAIT){
-		processEnqueue(ReadyPQ, thePCB);
-		thePCB->m_state = RDY;
+	envelope* env;
+	int handle;
+	U32 primask;
+	
+	env = (envelope*) message_envelope - 1;
+	if (env->refs > 1 || delay_us < 0) {
+		return RTX_ERR; // shared blocks are read-only
 	}
+	env->sender_id = gp_current_process->m_pid;
 	
-	return RTX_OK;
+	primask = __get_PRIMASK();
+	__disable_irq();
+	handle = timer_add_us(env, process_id, delay_us);
+	__set_PRIMASK(primask);
 	
+	//a delay shorter than the time left in the tick may have sent it already
+	if (exists_higher_priority_ready_process()) {
+		k_release_processor();
+	}
+	return handle;
 }
 
-int timer_send_message(envelope* env) {
+/**
+ * @brief: finds the pending delayed message of handle, if the current process sent it
+ */
+timerEntry* own_timer(int handle) {
+	timerEntry* entry = timer_lookup(handle);
 	
+	if (entry == NULL || entry->env->sender_id != gp_current_process->m_pid) {
+		return NULL;
+	}
+	return entry;
+}
+
+/**
+ * @brief: stops a delayed message from going out
+ * @return: the message, now owned by the caller again, or NULL if the handle
+ *          is stale (the message was already sent) or not the caller's
+ */
+void* k_cancel_delayed_send(int handle) {
+	timerEntry* entry;
+	envelope* env = NULL;
+	U32 primask;
+	
+	primask = __get_PRIMASK();
+	__disable_irq();
+	entry = own_timer(handle);
+	if (entry != NULL) {
+		env = timer_cancel(entry);
+	}
+	__set_PRIMASK(primask);
+	
+	if (env == NULL) {
+		return NULL;
+	}
+	return (void*) (env + 1);
+}
+
+/**
+ * @brief: makes a pending delayed message go out delay ticks from now instead
+ * @return: RTX_ERR if the handle is stale or not the caller's, RTX_OK otherwise
+ */
+int k_rearm_delayed_send(int handle, int delay) {
+	timerEntry* entry;
+	U32 primask;
+	
+	primask = __get_PRIMASK();
+	__disable_irq();
+	entry = own_timer(handle);
+	if (entry != NULL) {
+		timer_rearm(entry, get_time() + delay, gp_current_process->m_timer_slack);
+	}
+	__set_PRIMASK(primask);
+	
+	return entry == NULL ? RTX_ERR : RTX_OK;
+}
+
+/**
+ * @brief: lets the current process's delayed messages go out up to slack ticks
+ *         late, so they can share a tick, and a single scheduling decision,
+ *         with other delayed messages. See timer_slack.
+ *         delayed_send_us is not affected.
+ * @return: RTX_ERR if slack is negative, RTX_OK otherwise
+ */
+int k_set_timer_slack(int slack) {
+	if (slack < 0) {
+		return RTX_ERR;
+	}
+	gp_current_process->m_timer_slack = slack;
+	return RTX_OK;
+}
+
+/**
+ * @brief: delivers one block to the mailboxes of all num_pids processes in pids
+ *         without copying it. Every receiver but the first gets an alias from
+ *         msgAliases, and the block only goes back to the heap once every
+ *         receiver has released it. Receivers must not modify or resend it.
+ *         Like send_message, it waits until every mailbox has room.
+ * @return: RTX_ERR if a pid is invalid or there are not enough aliases, in which
+ *          case nothing is delivered. RTX_OK otherwise.
+ */
+int k_send_message_multi(int* pids, int num_pids, void* message_envelope) {
+	envelope* block;
+	envelope* env;
+	msgAlias* alias;
 	PCB* thePCB;
+	int preempt = 0;
+	int i;
 	
-	thePCB = gp_pcbs[env->recv_id];
+	block = (envelope*) message_envelope - 1;
+	if (num_pids <= 0 || block->refs > 1) {
+		return RTX_ERR;
+	}
+	for (i = 0; i < num_pids; i++) {
+		if (pids[i] < 0 || pids[i] >= PID_TIMER_IPROC) {
+			return RTX_ERR;
+		}
+	}
 	
-	if (thePCB->msgTail == NULL) {
-		thePCB->msgHead = env;
-		thePCB->msgTail = env;
+	// all or nothing, so wait for room first. Others run while we wait and
+	// may fill a mailbox already checked, then start over.
+	for (i = 0; i < num_pids; i++) {
+		thePCB = gp_pcbs[pids[i]];
+		if (thePCB != gp_current_process && mailboxFull(thePCB, 1)) {
+			mailboxWaitForRoom(thePCB, 1);
+			i = -1;
+		}
 	}
-	else {
-		thePCB->msgTail->next = env;
-		thePCB->msgTail = env;
+	if (num_pids - 1 > numFreeAliases) {
+		return RTX_ERR;
 	}
 	
-	if (thePCB->m_state == WAIT){
-		processEnqueue(ReadyPQ, thePCB);
-		thePCB->m_state = RDY;
+	block->refs = num_pids;
+	block->sender_id = gp_current_process->m_pid;
+	
+	for (i = 0; i < num_pids; i++) {
+		env = block;
+		if (i > 0) {
+			alias = freeAliases;
+			freeAliases = (msgAlias*) alias->env.next;
+			numFreeAliases--;
+			
+			alias->target = block;
+			alias->env.sender_id = block->sender_id;
+			alias->env.refs = 0;
+			alias->env.flags = block->flags;
+			env = &alias->env;
+		}
+		
+		thePCB = gp_pcbs[pids[i]];
+		if (deliverMessage(thePCB, env) && thePCB->m_priority < gp_current_process->m_priority) {
+			preempt = 1;
+		}
 	}
 	
+	if (preempt) {
+		k_release_processor();
+	}
 	return RTX_OK;
-	
 }
 
-envelope* k_receive_message_non_blocking(int proc_id) {
-	envelope* envelope = gp_pcbs[proc_id]->msgHead;
+/**
+ * @brief: finds the topic called name, or makes one if create is set
+ * @return: the topic, or NULL if there is none and none could be made
+ */
+topic* findTopic(char* name, int create) {
+	topic* unused = NULL;
+	int i;
+	int j;
+	
+	for (i = 0; i < NUM_TOPICS; i++) {
+		if (topics[i].name[0] == '\0') {
+			if (unused == NULL) {
+				unused = &topics[i];
+			}
+			continue;
+		}
+		for (j = 0; j < TOPIC_NAME_LEN - 1 && topics[i].name[j] == name[j] && name[j] != '\0'; j++);
+		if (j == TOPIC_NAME_LEN - 1 || topics[i].name[j] == name[j]) {
+			return &topics[i];
+		}
+	}
 	
-	if (envelope == NULL) {
+	if (!create || unused == NULL || name[0] == '\0') {
 		return NULL;
 	}
-	
-	if (gp_pcbs[proc_id]->msgHead == gp_pcbs[proc_id]->msgTail) {
-    gp_pcbs[proc_id]->msgHead = NULL;
-    gp_pcbs[proc_id]->msgTail = NULL;
-  }
-  else {
-    gp_pcbs[proc_id]->msgHead = gp_pcbs[proc_id]->msgHead->next;
-  }
+	for (j = 0; j < TOPIC_NAME_LEN - 1 && name[j] != '\0'; j++) {
+		unused->name[j] = name[j];
+	}
+	unused->name[j] = '\0';
+	unused->subscribers = 0;
+	return unused;
+}
 
-	return envelope;
+/**
+ * @brief: makes process_id receive every message published to the topic
+ *         called name, creating the topic if needed. Names longer than
+ *         TOPIC_NAME_LEN - 1 characters are cut short.
+ * @return: RTX_ERR if process_id is invalid or there are NUM_TOPICS topics
+ *          already, RTX_OK otherwise
+ */
+int k_subscribe(char* name, int process_id) {
+	topic* theTopic;
+	
+	if (process_id < 0 || process_id >= PID_TIMER_IPROC) {
+		return RTX_ERR;
+	}
+	theTopic = findTopic(name, 1);
+	if (theTopic == NULL) {
+		return RTX_ERR;
+	}
+	theTopic->subscribers |= 1u << process_id;
+	return RTX_OK;
 }
 
-/*int k_has_message(int process_id) {
-	PCB* thePCB = gp_pcbs[process_id];;
-	if (thePCB->msgHead == NULL) {
-		return 0;
+/**
+ * @brief: undoes k_subscribe. A topic without subscribers is freed.
+ */
+int k_unsubscribe(char* name, int process_id) {
+	topic* theTopic = findTopic(name, 0);
+	
+	if (theTopic == NULL || process_id < 0 || process_id >= PID_TIMER_IPROC) {
+		return RTX_ERR;
 	}
-	
-	return 1;
-}*/
+	theTopic->subscribers &= ~(1u << process_id);
+	if (theTopic->subscribers == 0) {
+		theTopic->name[0] = '\0';
+	}
+	return RTX_OK;
+}
 
-int k_delayed_send(int process_id, void* message_envelope, int delay) {
+/**
+ * @brief: delivers the message to every subscriber of the topic called name.
+ *         The block is shared, not copied, see k_send_message_multi, and
+ *         the caller waits while a subscriber's mailbox is full.
+ * @return: RTX_ERR if nobody subscribed or there are not enough aliases, in which
+ *          case the caller still owns the message. RTX_OK otherwise.
+ */
+int k_publish(char* name, void* message_envelope) {
+	topic* theTopic = findTopic(name, 0);
+	int pids[NUM_PROCS];
+	int n = 0;
+	int i;
+	
+	if (theTopic == NULL) {
+		return RTX_ERR;
+	}
+	for (i = 0; i < NUM_PROCS; i++) {
+		if (theTopic->subscribers & (1u << i)) {
+			pids[n++] = i;
+		}
+	}
+	return k_send_message_multi(pids, n, message_envelope);
+}
+
+/**
+ * @brief: limits how many messages may wait in the mailbox of process_id.
+ *         Senders to a full mailbox block until the receiver makes room,
+ *         kernel and i-process senders ignore the limit.
+ * @return: RTX_ERR if process_id or limit is invalid, RTX_OK otherwise
+ */
+int k_set_mailbox_limit(int process_id, int limit) {
+	if (process_id < 0 || process_id >= NUM_PROCS || limit < 0) {
+		return RTX_ERR;
+	}
+	gp_pcbs[process_id]->m_msg_limit = limit;
 	
+	// a raised limit may have room for waiting senders
+	wakeSenders(gp_pcbs[process_id]);
+	if (exists_higher_priority_ready_process()) {
+		k_release_processor();
+	}
+	return RTX_OK;
+}
+
+/**
+ * @brief: sends the n messages in msgs to process_id, in order, in a single
+ *         kernel entry with at most one context switch at the end
+ * @return: RTX_ERR if the pid or a message is invalid, in which case nothing
+ *          is sent. RTX_OK otherwise.
+ */
+int k_send_message_batch(int process_id, void** msgs, int n) {
+	PCB* thePCB;
 	envelope* env;
+	int i;
 	
-	env = (envelope*) message_envelope - 1;
-	env->next = NULL;
-	env->sender_id = gp_current_process->m_pid;
-	env->recv_id = process_id;
-	env->send_time = get_time() + delay;
+	if (process_id < 0 || process_id >= PID_TIMER_IPROC || n <= 0) {
+		return RTX_ERR;
+	}
+	for (i = 0; i < n; i++) {
+		if (((envelope*) msgs[i] - 1)->refs > 1) {
+			return RTX_ERR; // shared blocks are read-only
+		}
+	}
 	
-	if (gp_pcbs[PID_TIMER_IPROC]->msgTail == NULL) {
-		gp_pcbs[PID_TIMER_IPROC]->msgHead = env;
-		gp_pcbs[PID_TIMER_IPROC]->msgTail = env;
+	thePCB = gp_pcbs[process_id];
+	if (thePCB->m_msg_limit != 0 && n > thePCB->m_msg_limit) {
+		return RTX_ERR; // would never fit
+	}
+	mailboxWaitForRoom(thePCB, n);
+	
+	for (i = 0; i < n; i++) {
+		env = (envelope*) msgs[i] - 1;
+		env->sender_id = gp_current_process->m_pid;
+		mailboxEnqueue(thePCB, env);
+	}
+	
+	// like send_message, the receiver has to beat ReadyPQ too for a handoff
+	if (thePCB->m_state == WAIT && thePCB->m_priority < gp_current_process->m_priority
+			&& !exists_ready_process_above(thePCB->m_priority)) {
+		thePCB->m_state = RDY;
+		process_handoff(thePCB);
 	}
 	else {
-		gp_pcbs[PID_TIMER_IPROC]->msgTail->next = env;
-		gp_pcbs[PID_TIMER_IPROC]->msgTail = env;
+		if (thePCB->m_state == WAIT) {
+			thePCB->m_state = RDY;
+			processEnqueue(ReadyPQ, thePCB);
+		}
+		if (exists_higher_priority_ready_process()) {
+			k_release_processor();
+		}
 	}
-	//No need for pre-emption
 	return RTX_OK;
 }
+
+/**
+ * @brief: waits for at least one message, then takes up to max messages from
+ *         the mailbox in a single kernel entry. senders may be NULL.
+ * @return: the number of messages stored in msgs, or RTX_ERR if max <= 0
+ */
+int k_receive_message_batch(void** msgs, int* senders, int max) {
+	PCB* thePCB = gp_current_process;
+	envelope* env;
+	int n;
+	
+	if (max <= 0) {
+		return RTX_ERR;
+	}
+	while (mailboxEmpty(thePCB)) {
+		thePCB->m_state = WAIT;
+		k_release_processor();
+	}
+	
+	for (n = 0; n < max && (env = mailboxDequeue(thePCB)) != NULL; n++) {
+		if (senders != NULL) {
+			senders[n] = env->sender_id;
+		}
+		msgs[n] = envelopeToMessage(env);
+	}
+	yieldToSenders();
+	return n;
+}
+
+/**
+ * @brief: records that the first length bytes of the mtext of a block are in use.
+ *         The length stays with the block through sends until it is released.
+ * @return: RTX_ERR if the block is invalid or length exceeds MSG_CAPACITY
+ */
+int k_set_message_length(void* message_envelope, int length) {
+	envelope* env = (envelope*) message_envelope - 1;
+	
+	if (!isHeapBlock(env) || length < 0 || length > MSG_CAPACITY) {
+		return RTX_ERR;
+	}
+	env->length = length;
+	return RTX_OK;
+}
+
+/**
+ * @brief: returns the length set on a block with set_message_length, MSG_LEN_TEXT
+ *         if there is none, or RTX_ERR if the block is invalid
+ */
+int k_get_message_length(void* message_envelope) {
+	envelope* env = (envelope*) message_envelope - 1;
+	
+	if (!isHeapBlock(env)) {
+		return RTX_ERR;
+	}
+	return env->length == ENV_LEN_TEXT ? MSG_LEN_TEXT : env->length;
+}
+
+/**
+ * @brief: returns the number of mtext bytes a block can hold
+ */
+int k_get_message_capacity(void) {
+	return MSG_CAPACITY;
+}
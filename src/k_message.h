@@ -4,6 +4,7 @@
 // #include "k_rtx.h"
 
 #include "msg_buf.h"
+#include "rtx_stats.h"
 
 /* ---- Forward Declarations ---- */
 typedef struct pcb PCB;
@@ -12,12 +13,45 @@ typedef struct PCBQ PCBQ;
 
 
 
+#define NUM_MSG_ALIASES 32
+
+/* length of a block nobody has set a length on, its mtext is NUL-terminated text */
+#define MSG_LEN_TEXT -2
+#define ENV_LEN_TEXT 0xFF /* MSG_LEN_TEXT as stored in the envelope */
+
+/* bytes of mtext that fit in a block after the envelope and mtype */
+#define MSG_CAPACITY ((int) (BLOCK_SIZE - sizeof(envelope) - sizeof(int)))
+
 typedef struct _envelope envelope;
+/* 8 bytes (12 with DEBUG_MAILBOX), the receiver is known from the mailbox the
+   envelope is in, and delayed messages keep theirs and their send time in the
+   timer entry */
 struct _envelope {
 	envelope* next;
-	int sender_id;
-	int recv_id;
-	int send_time;
+	unsigned char sender_id;
+	unsigned char refs;     /* number of receivers still holding the block */
+	unsigned char length;   /* bytes of mtext in use, or ENV_LEN_TEXT */
+	unsigned char flags;    /* MSG_URGENT, MSG_NOTIFY */
+#ifdef DEBUG_MAILBOX
+	unsigned int stamp;     /* clock_cycles() when it was queued */
+#endif
+};
+
+/* Stands in for a shared block in the mailboxes of all but the first receiver of a multicast */
+typedef struct msgAlias msgAlias;
+struct msgAlias {
+	envelope env;
+	envelope* target; /* the shared block */
+};
+
+#define NUM_TOPICS 16
+#define TOPIC_NAME_LEN 8 /* including the NUL */
+
+/* A named topic, published messages go to every subscriber */
+typedef struct topic topic;
+struct topic {
+	char name[TOPIC_NAME_LEN]; /* empty while the topic is unused */
+	unsigned int subscribers;  /* bit n set if process n subscribed */
 };
 
 extern PCB **gp_pcbs;
@@ -28,8 +62,33 @@ extern PCBQ ReadyPQ[];
 int k_send_message(int process_id, void* message_envelope);
 //int k_has_message(int process_id);
 void* k_receive_message(int* sender_id);
+void* k_receive_message_timeout(int* sender_id, int ticks);
+void* k_receive_message_filtered(int* sender_id, int mtype, int sender);
+void* k_send_receive(int process_id, void* message_envelope);
+int k_reply(int process_id, void* message_envelope);
+int k_send_message_urgent(int process_id, void* message_envelope);
+int k_try_send_message(int process_id, void* message_envelope);
+int k_send_message_async(int process_id, void* message_envelope, int notify);
+int k_get_delivered_count(void);
+int k_get_mailbox_stats(int process_id, MAILBOX_STATS* stats);
+int k_set_mailbox_limit(int process_id, int limit);
+int k_send_message_batch(int process_id, void** msgs, int n);
+int k_receive_message_batch(void** msgs, int* senders, int max);
 int k_delayed_send(int process_id, void* message_envelope, int delay);
+int k_delayed_send_at(int process_id, void* message_envelope, int send_time);
+int k_delayed_send_us(int process_id, void* message_envelope, int delay_us);
+void* k_cancel_delayed_send(int handle);
+int k_rearm_delayed_send(int handle, int delay);
+int k_set_timer_slack(int slack);
 envelope* k_receive_message_non_blocking(int proc_id);
 int k_send_message_non_preempt(int process_id, void* message_envelope);
-int timer_send_message(envelope* message_envelope);
+int timer_send_message(int process_id, envelope* message_envelope);
+int k_send_message_multi(int* pids, int num_pids, void* message_envelope);
+int k_subscribe(char* name, int process_id);
+int k_unsubscribe(char* name, int process_id);
+int k_publish(char* name, void* message_envelope);
+void message_init(void);
+int k_set_message_length(void* message_envelope, int length);
+int k_get_message_length(void* message_envelope);
+int k_get_message_capacity(void);
 #endif
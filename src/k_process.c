@@ -32,6 +32,8 @@ PCB* null_pcb;
 
 PCBQ ReadyPQ[NUM_OF_PRIORITIES];
 PCBQ BlockPQ[NUM_OF_PRIORITIES];
+PCBQ SendPQ[NUM_OF_PRIORITIES]; /* senders waiting for room in a full mailbox */
+int numTimedWaits = 0;          /* number of processes in a timed wait */
 
 U32 g_switch_flag = 0;          /* whether to continue to run the process before the UART receive interrupt */
                                 /* 1 means to switch to another process, 0 means to continue the current process */
@@ -117,8 +119,15 @@ PCB* processDequeue(PCBQ pq[])
 }
 
 int exists_higher_priority_ready_process() {
-	for (int i = 0; i < NUM_OF_PRIORITIES; i++){
-    if (ReadyPQ[i].head != NULL && i < gp_current_process->m_priority){
+	return exists_ready_process_above(gp_current_process->m_priority);
+}
+
+/**
+ * @brief: whether a ready process has a better priority than priority
+ */
+int exists_ready_process_above(int priority) {
+	for (int i = 0; i < priority; i++){
+    if (ReadyPQ[i].head != NULL){
       return 1;
     }
   }
@@ -130,11 +139,16 @@ int exists_higher_priority_ready_process() {
  */
 void makeReady()
 {
+	U32 primask = __get_PRIMASK();
+
+	// the timer i-process takes timed waits off BlockPQ
+	__disable_irq();
 	while (!blockPQIsEmpty()) {
 		PCB* thePCB = processDequeue(BlockPQ);
 		thePCB->m_state = RDY;
 		processEnqueue(ReadyPQ, thePCB);
 	}
+	__set_PRIMASK(primask);
 	if(exists_higher_priority_ready_process()){
 		k_release_processor();
 	}
@@ -145,6 +159,8 @@ void makeReady()
  */
 void makeBlock()
 {
+  // k_release_processor enables interrupts again once we are on BlockPQ
+  __disable_irq();
   gp_current_process->m_state = BLK;
   k_release_processor();
 }
@@ -162,6 +178,28 @@ int queueIsEmpty(PCBQ pq[]) {
   return 1;
 }
 
+/**
+ * @brief: readies every process waiting for room in the mailbox of thePCB.
+ *         They retry their sends when they run.
+ */
+void wakeSenders(PCB* thePCB)
+{
+  PCB* cur;
+  PCB* next;
+  int i;
+
+  for (i = 0; i < NUM_OF_PRIORITIES; i++) {
+    for (cur = SendPQ[i].head; cur != NULL; cur = next) {
+      next = cur->nextPCB;
+      if (cur->m_send_to == thePCB->m_pid) {
+        processRemove(SendPQ, cur, i);
+        cur->m_state = RDY;
+        processEnqueue(ReadyPQ, cur);
+      }
+    }
+  }
+}
+
 /**
  * @brief: Checks if the block queue is empty
  */
@@ -245,8 +283,19 @@ void process_init()
     (gp_pcbs[i])->m_state = NEW;
     (gp_pcbs[i])->m_priority = (g_proc_table[i]).m_priority;
     (gp_pcbs[i])->nextPCB = NULL;
-		(gp_pcbs[i])->msgHead = NULL;
-		(gp_pcbs[i])->msgTail = NULL;
+		for (j = 0; j < MSG_QUEUES; j++) {
+			(gp_pcbs[i])->msgHead[j] = NULL;
+			(gp_pcbs[i])->msgTail[j] = NULL;
+		}
+		(gp_pcbs[i])->m_wake_time = 0;
+		(gp_pcbs[i])->m_timed_wait = TIMED_WAIT_NONE;
+		(gp_pcbs[i])->m_timer_slack = 0;
+		(gp_pcbs[i])->m_reply = NULL;
+		(gp_pcbs[i])->m_reply_from = -1;
+		(gp_pcbs[i])->m_msg_count = 0;
+		(gp_pcbs[i])->m_msg_limit = 0;
+		(gp_pcbs[i])->m_send_to = -1;
+		(gp_pcbs[i])->m_delivered = 0;
 
     sp = alloc_stack((g_proc_table[i]).m_stack_size);
     *(--sp)  = INITIAL_xPSR;      // user process initial xPSR
@@ -262,6 +311,8 @@ void process_init()
     ReadyPQ[i].tail = NULL;
     BlockPQ[i].head = NULL;
     BlockPQ[i].tail = NULL;
+    SendPQ[i].head = NULL;
+    SendPQ[i].tail = NULL;
   }
 
   /* initialize priority queue */
@@ -286,6 +337,9 @@ PCB *scheduler(void)
     if (gp_current_process->m_state == BLK){
       processEnqueue(BlockPQ, gp_current_process);
     }
+    else if (gp_current_process->m_state == BLK_SEND) {
+      processEnqueue(SendPQ, gp_current_process);
+    }
     else if (gp_current_process->m_state == RUN) {
       processEnqueue(ReadyPQ, gp_current_process);
     }
@@ -293,6 +347,14 @@ PCB *scheduler(void)
   return processDequeue(ReadyPQ);
 }
 
+/**
+ * @brief: whether a process in state can not run until something wakes it
+ */
+int isBlocked(PROC_STATE_E state)
+{
+  return state == BLK || state == WAIT || state == WAIT_REPLY || state == BLK_SEND;
+}
+
 /*@brief: switch out old pcb (p_pcb_old), run the new pcb (gp_current_process)
  *@param: p_pcb_old, the old pcb that was in RUN
  *@return: RTX_OK upon success
@@ -309,7 +371,7 @@ int process_switch(PCB *p_pcb_old)
 
   if (state == NEW) {
     if (gp_current_process != p_pcb_old && p_pcb_old->m_state != NEW) {
-      if (p_pcb_old->m_state != BLK && p_pcb_old->m_state != WAIT){
+      if (!isBlocked(p_pcb_old->m_state)){
         p_pcb_old->m_state = RDY;
       }
       p_pcb_old->mp_sp = (U32 *) __get_MSP();
@@ -322,7 +384,7 @@ int process_switch(PCB *p_pcb_old)
   /* The following will only execute if the if block above is FALSE */
   if (gp_current_process != p_pcb_old) {
     if (state == RDY){
-      if (p_pcb_old->m_state != BLK && p_pcb_old->m_state != WAIT){
+      if (!isBlocked(p_pcb_old->m_state)){
         p_pcb_old->m_state = RDY;
       }
       p_pcb_old->mp_sp = (U32 *) __get_MSP(); // save the old process's sp
@@ -345,6 +407,8 @@ int k_release_processor(void)
 {
   PCB *p_pcb_old = NULL;
 
+  // the scheduler changes queues the i-processes change too
+  __disable_irq();
   p_pcb_old = gp_current_process;
   gp_current_process = scheduler();
 
@@ -361,46 +425,142 @@ int k_release_processor(void)
 }
 
 /**
- * @brief moves pcb to its correct queue (for the case where a process changes another process' priority)
+ * @brief: switches straight to thePCB without scanning ReadyPQ. The current
+ *         process is queued as scheduler() would queue it.
+ * PRE: thePCB is RDY or NEW and in no queue, and no ready process has a
+ *      better priority than it
  */
-void moveProcessToPriority(PCB* thePCB, int old_priority) {
-  PCBQ* pq;
-   if (thePCB->m_state == BLK) {
-     pq = BlockPQ;
-   }
-   else {
-    pq = ReadyPQ;
+int process_handoff(PCB* thePCB)
+{
+  PCB *p_pcb_old = gp_current_process;
+
+  __disable_irq();
+  if (p_pcb_old->m_state == BLK) {
+    processEnqueue(BlockPQ, p_pcb_old);
+  }
+  else if (p_pcb_old->m_state == BLK_SEND) {
+    processEnqueue(SendPQ, p_pcb_old);
+  }
+  else if (p_pcb_old->m_state == RUN) {
+    processEnqueue(ReadyPQ, p_pcb_old);
   }
+  gp_current_process = thePCB;
+  process_switch(p_pcb_old);
+	__enable_irq();
+  return RTX_OK;
+}
 
+/**
+ * @brief removes pcb from the queue of the given priority
+ * @return RTX_ERR if the pcb is not in the queue, RTX_OK otherwise
+ */
+int processRemove(PCBQ pq[], PCB* thePCB, int priority) {
   // remove from queue (many cases to consider)
-  if (pq[old_priority].head == NULL) { // empty
-    return; // error
-  } else if (pq[old_priority].head == pq[old_priority].tail) { // 1 element
-    if (thePCB != pq[old_priority].head) {
-      return; // error
+  if (pq[priority].head == NULL) { // empty
+    return RTX_ERR;
+  } else if (pq[priority].head == pq[priority].tail) { // 1 element
+    if (thePCB != pq[priority].head) {
+      return RTX_ERR;
     }
-    pq[old_priority].head = NULL;
-    pq[old_priority].tail = NULL;
-  } else if (pq[old_priority].head == thePCB) { // 1st element in LL with length > 1
-    pq[old_priority].head = pq[old_priority].head->nextPCB;
+    pq[priority].head = NULL;
+    pq[priority].tail = NULL;
+  } else if (pq[priority].head == thePCB) { // 1st element in LL with length > 1
+    pq[priority].head = pq[priority].head->nextPCB;
   } else { // middle of the linked list
     PCB* current;
-    for (current = pq[old_priority].head; current != NULL; current=current->nextPCB) {
+    for (current = pq[priority].head; current != NULL; current=current->nextPCB) {
       if (current->nextPCB == thePCB) {
         current->nextPCB = thePCB->nextPCB;
 
-        if (thePCB == pq[old_priority].tail) {
-          pq[old_priority].tail = current;
+        if (thePCB == pq[priority].tail) {
+          pq[priority].tail = current;
         }
         break;
       }
     }
+    if (current == NULL) {
+      return RTX_ERR;
+    }
   }
 
   thePCB->nextPCB = NULL;
+  return RTX_OK;
+}
+
+/**
+ * @brief moves pcb to its correct queue (for the case where a process changes another process' priority)
+ */
+void moveProcessToPriority(PCB* thePCB, int old_priority) {
+  PCBQ* pq;
+   if (thePCB->m_state == BLK) {
+     pq = BlockPQ;
+   }
+   else if (thePCB->m_state == BLK_SEND) {
+     pq = SendPQ;
+   }
+   else {
+    pq = ReadyPQ;
+  }
+
+  if (processRemove(pq, thePCB, old_priority) == RTX_ERR) {
+    return; // error
+  }
   processEnqueue(pq, thePCB);
 }
 
+/**
+ * @brief: starts a timed wait for the current process. If the process is still
+ *         blocked or waiting at wake_time, the timer i-process readies it and sets
+ *         m_timed_wait to TIMED_WAIT_EXPIRED. Must be paired with timedWaitEnd().
+ */
+void timedWaitStart(U32 wake_time)
+{
+  gp_current_process->m_wake_time = wake_time;
+  gp_current_process->m_timed_wait = TIMED_WAIT_ACTIVE;
+  numTimedWaits++;
+}
+
+/**
+ * @brief: ends the timed wait of the current process
+ */
+void timedWaitEnd(void)
+{
+  gp_current_process->m_timed_wait = TIMED_WAIT_NONE;
+  numTimedWaits--;
+}
+
+/**
+ * @brief: called by the timer i-process every tick. Readies the processes whose
+ *         timed waits have run out, taking them off BlockPQ if needed.
+ */
+void timedWaitTick(U32 now)
+{
+  int i;
+  PCB* thePCB;
+
+  if (numTimedWaits == 0) {
+    return;
+  }
+
+  for (i = 0; i < NUM_PROCS; i++) {
+    thePCB = gp_pcbs[i];
+    if (thePCB->m_timed_wait != TIMED_WAIT_ACTIVE || TIME_BEFORE(now, thePCB->m_wake_time)) {
+      continue;
+    }
+
+    if (thePCB->m_state == BLK) {
+      processRemove(BlockPQ, thePCB, thePCB->m_priority);
+    }
+    else if (thePCB->m_state != WAIT) {
+      continue; // already readied, it will see the timeout when it runs
+    }
+
+    thePCB->m_timed_wait = TIMED_WAIT_EXPIRED;
+    thePCB->m_state = RDY;
+    processEnqueue(ReadyPQ, thePCB);
+  }
+}
+
 /**
  * @brief Sets process priority, then calls release_processor()
  * @return RTX_ERR on error and RTX_OK on success
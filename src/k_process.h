@@ -26,6 +26,7 @@ struct PCBQ {
 
 /* ----- Global Variables ----- */
 extern PCBQ ReadyPQ[NUM_OF_PRIORITIES];
+extern PCBQ SendPQ[NUM_OF_PRIORITIES];
 extern PROC_INIT g_test_procs[NUM_TEST_PROCS];
 
 /* ----- Functions ----- */
@@ -37,6 +38,15 @@ int set_process_priority(int process_id, int priority); /* sets priority of this
 int get_process_priority(int process_id);                /* returns the priority of the specified process. Returns -1 if failed */
 void nullProc(void);
 void processEnqueue(PCBQ pq[], PCB* thePCB);
+int processRemove(PCBQ pq[], PCB* thePCB, int priority);
+int process_handoff(PCB* thePCB);      /* run thePCB next, skipping the scheduler */
+int exists_ready_process_above(int priority);
+int isBlocked(PROC_STATE_E state);
+void wakeSenders(PCB* thePCB);         /* ready processes waiting for room in thePCB's mailbox */
+int queueIsEmpty(PCBQ pq[]);
+void timedWaitStart(U32 wake_time);    /* give up waiting at wake_time */
+void timedWaitEnd(void);
+void timedWaitTick(U32 now);           /* expire timed waits, called every tick */
 
 extern U32 *alloc_stack(U32 size_b);   /* allocate stack for a process */
 extern void __rte(void);               /* pop exception stack frame */
@@ -44,6 +54,7 @@ extern void set_test_procs(void);      /* test process initial set up */
 extern void makeBlock(void);					/* Sets state of current process to blocked */
 extern void makeReady(void);					/* Transfers the highest priority PCB from the block queue to the ready queue*/
 extern int blockPQIsEmpty(void);
+extern int exists_higher_priority_ready_process(void);
 extern void timer_i_process(void);
 extern void* k_request_memory_block_non_blocking( void );
 
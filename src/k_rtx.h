@@ -9,6 +9,7 @@
 #define K_RTX_H_
 
 // #include "k_message.h"
+#include "rtx_stats.h"
 
 /*----- Definitations -----*/
 
@@ -50,6 +51,19 @@
 #define KCD_REG 1
 #define ECHO 2
 
+/* Envelope flags */
+#define MSG_URGENT 0x1 /* received ahead of every normal message */
+#define MSG_NOTIFY 0x2 /* counted in the sender's m_delivered once received */
+
+/* A mailbox is a FIFO queue per message priority, urgent first */
+#define MSG_QUEUES 2
+#define MSG_QUEUE_URGENT 0
+#define MSG_QUEUE_NORMAL 1
+
+/* receive_message_filtered wildcards */
+#define ANY_TYPE   -1
+#define ANY_SENDER -1
+
 #ifdef DEBUG_0
 #define USR_SZ_STACK 0x200         /* user proc stack size 512B   */
 #else
@@ -66,7 +80,12 @@ typedef struct _envelope envelope;
 /* process states, note we only assume three states in this example */
 //BLK means that the process is blocked on memory.
 //WAIT means that the process is waiting for a message.
-typedef enum {NEW = 0, RDY, RUN, BLK, WAIT} PROC_STATE_E;
+typedef enum {NEW = 0, RDY, RUN, BLK, WAIT, WAIT_REPLY, BLK_SEND} PROC_STATE_E;
+
+/* timed wait status of a process, see timedWaitStart() */
+#define TIMED_WAIT_NONE    0
+#define TIMED_WAIT_ACTIVE  1
+#define TIMED_WAIT_EXPIRED 2
 
 /*
   PCB data structure definition.
@@ -82,8 +101,17 @@ struct pcb
   int m_priority; /* process priority */
   PROC_STATE_E m_state;   /* state of the process */
   PCB* nextPCB; /* pointer to next PCB, if PCB is in a queue */
-	envelope* msgHead;
-	envelope* msgTail;
+	envelope* msgHead[MSG_QUEUES]; /* mailbox, see MSG_QUEUES */
+	envelope* msgTail[MSG_QUEUES];
+	U32 m_wake_time;   /* tick at which a timed wait gives up */
+	int m_timed_wait;  /* TIMED_WAIT_NONE, TIMED_WAIT_ACTIVE or TIMED_WAIT_EXPIRED */
+	U32 m_timer_slack; /* ticks its delayed messages may go out late by */
+	envelope* m_reply; /* answer to send_receive, NULL until reply() */
+	int m_reply_from;  /* process send_receive is waiting on */
+	int m_msg_count;   /* messages in the mailbox */
+	int m_msg_limit;   /* most messages senders may queue, 0 for no limit */
+	int m_send_to;     /* process whose full mailbox a BLK_SEND process waits on */
+	int m_delivered;   /* its MSG_NOTIFY messages that have been received */
 };
 
 /* initialization table item */
@@ -11,17 +11,24 @@
 #include "k_memory.h"
 #include "k_process.h"
 #include "timer.h"
+#include "k_message.h"
+#include "rtc.h"
 
 void k_rtx_init(void)
 {
 	__disable_irq();
 	timer_init(0);
+	clock_init();
+#ifdef TIMER1_PROFILE
 	timer_init(1);
+#endif /* TIMER1_PROFILE */
 	uart_irq_init(0);   // uart0, interrupt-driven
 	uart1_init();       // uart1, polling
 	memory_init();
 	process_init();
 	heap_init();
+	message_init();
+	rtc_init();
 	__enable_irq();
 
 	/* start the first process */
@@ -0,0 +1,139 @@
+/**
+ * @brief: rtc.c - The LPC17xx real-time clock keeps the time of day for the
+ *         %W wall clock. Its seconds interrupt prints the time, so the clock
+ *         needs no timer messages and does not drift when processes run late.
+ *         See chapter 27 of LPC17xx_UM.
+ */
+
+#include <LPC17xx.h>
+#include "rtc.h"
+#include "k_rtx.h"
+#include "k_memory.h"
+#include "k_message.h"
+
+#define BIT(X) (1<<X)
+
+#define PCONP_PCRTC   BIT(9)  /* RTC power */
+#define CCR_CLKEN     BIT(0)  /* clock enable */
+#define CCR_CTCRST    BIT(1)  /* reset the sub-second counter */
+#define CIIR_IMSEC    BIT(0)  /* interrupt when SEC increments */
+#define ILR_RTCCIF    BIT(0)  /* counter increment interrupt, write 1 to clear */
+
+int g_rtc_display = 0; // 1 while %WR/%WS is displaying the time
+
+extern int k_release_processor(void);
+extern int exists_higher_priority_ready_process(void);
+
+/**
+ * @brief: powers the RTC, starts it counting and enables the seconds interrupt.
+ *         The RTC runs from its own 32 kHz oscillator, so the time does not
+ *         depend on TIMER0.
+ */
+void rtc_init(void)
+{
+	LPC_SC->PCONP |= PCONP_PCRTC;
+
+	LPC_RTC->ILR = ILR_RTCCIF;
+	LPC_RTC->CIIR = CIIR_IMSEC;
+	LPC_RTC->AMR = 0xFF; // no alarms
+	LPC_RTC->CCR = CCR_CLKEN;
+
+	g_rtc_display = 0;
+	NVIC_EnableIRQ(RTC_IRQn);
+}
+
+/**
+ * @brief: sets the RTC to seconds after midnight and starts displaying it
+ */
+int k_set_wall_clock(int seconds)
+{
+	if (seconds < 0) {
+		return RTX_ERR;
+	}
+
+	//stop the clock while the time is written, the next second is a full one
+	LPC_RTC->CCR = CCR_CTCRST;
+	LPC_RTC->HOUR = (seconds / (60 * 60)) % 24;
+	LPC_RTC->MIN = (seconds / 60) % 60;
+	LPC_RTC->SEC = seconds % 60;
+	LPC_RTC->CCR = CCR_CLKEN;
+
+	g_rtc_display = 1;
+	return RTX_OK;
+}
+
+int k_stop_wall_clock(void)
+{
+	g_rtc_display = 0;
+	return RTX_OK;
+}
+
+/**
+ * @brief: writes the time in CTIME0 to dest as hh:mm:ss, the way the %W
+ *         wall clock prints it. dest must have at least 11 bytes.
+ */
+void rtc_time_to_str(uint32_t time, char* dest)
+{
+	uint32_t hours = (time >> 16) & 0x1F;
+	uint32_t minutes = (time >> 8) & 0x3F;
+	uint32_t seconds = time & 0x3F;
+
+	dest[0] = '0' + hours / 10;
+	dest[1] = '0' + hours % 10;
+	dest[2] = ':';
+	dest[3] = '0' + minutes / 10;
+	dest[4] = '0' + minutes % 10;
+	dest[5] = ':';
+	dest[6] = '0' + seconds / 10;
+	dest[7] = '0' + seconds % 10;
+	dest[8] = '\n';
+	dest[9] = '\r';
+	dest[10] = '\0';
+}
+
+/**
+ * @brief: use CMSIS ISR for RTC IRQ Handler
+ */
+__asm void RTC_IRQHandler(void)
+{
+	PRESERVE8
+	IMPORT c_RTC_IRQHandler_wrapper
+	PUSH{r4-r11, lr}
+	BL c_RTC_IRQHandler_wrapper
+	POP{r4-r11, pc}
+}
+
+/**
+ * @brief: c RTC IRQ Handler, sends the time to the CRT once a second
+ */
+void c_RTC_IRQHandler(void)
+{
+	uint32_t time;
+	MSG_BUF* msg;
+
+	LPC_RTC->ILR = ILR_RTCCIF;
+
+	if (!g_rtc_display) {
+		return;
+	}
+
+	//CTIME0 holds seconds, minutes and hours read at the same instant
+	time = LPC_RTC->CTIME0;
+
+	//skip this second if the heap, reserve included, is empty
+	msg = (MSG_BUF*) k_request_memory_block_reserved(PID_CLOCK);
+	if (msg == NULL) {
+		return;
+	}
+	msg->mtype = DEFAULT;
+	rtc_time_to_str(time, msg->mtext);
+	k_send_message_non_preempt(PID_CRT, (void*) msg);
+}
+
+void c_RTC_IRQHandler_wrapper(void)
+{
+	c_RTC_IRQHandler();
+	if (exists_higher_priority_ready_process()) {
+		k_release_processor();
+	}
+}
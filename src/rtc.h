@@ -0,0 +1,15 @@
+/**
+ * @brief: rtc.h - Real-time clock behind the %W wall clock
+ */
+#ifndef RTC_H_
+#define RTC_H_
+
+#include <stdint.h>
+
+#define RTC_RESERVED_BLOCKS 2 /* heap blocks held back for the seconds display */
+
+extern void rtc_init(void);                 /* start the RTC and its seconds interrupt */
+extern int k_set_wall_clock(int seconds);   /* set the time of day and display it every second */
+extern int k_stop_wall_clock(void);         /* stop displaying it */
+
+#endif /* ! RTC_H_ */
@@ -6,6 +6,7 @@
 #define RTX_H_
 
 #include "msg_buf.h"
+#include "rtx_stats.h"
 
 /* ----- Definitations ----- */
 #define RTX_ERR -1
@@ -41,8 +42,13 @@
 #define KCD_REG 1
 #define ECHO 2
 
+/* receive_message_filtered wildcards */
+#define ANY_TYPE   -1
+#define ANY_SENDER -1
+
 /* ----- Types ----- */
 typedef unsigned int U32;
+typedef unsigned long long U64;
 
 /* initialization table item */
 typedef struct proc_init
@@ -53,6 +59,14 @@ typedef struct proc_init
 	void (*mpf_start_pc) ();/* entry point of the process */    
 } PROC_INIT;
 
+/* ----- Monotonic Clock ----- */
+/* Plain function calls, no system call involved */
+extern U64 clock_cycles(void);                 /* CPU cycles since rtx_init */
+extern U64 clock_us(void);                     /* microseconds since rtx_init */
+extern U64 clock_ticks(void);                  /* TIMER0 ticks (ms), get_system_time() without the wrap */
+extern U64 clock_cycles_to_us(U64 cycles);
+extern U32 clock_cycles_to_ticks(U64 cycles);
+
 /* ----- RTX User API ----- */
 #define __SVC_0  __svc_indirect(0)
 
@@ -80,6 +94,9 @@ extern void *k_request_memory_block(void);
 #define request_memory_block() _request_memory_block((U32)k_request_memory_block)
 extern void *_request_memory_block(U32 p_func) __SVC_0;
 
+extern void *k_request_memory_block_timeout(int ticks);
+#define request_memory_block_timeout(ticks) _request_memory_block_timeout((U32)k_request_memory_block_timeout, ticks)
+extern void *_request_memory_block_timeout(U32 p_func, int ticks) __SVC_0;
 
 extern int k_release_memory_block(void *);
 #define release_memory_block(p_mem_blk) _release_memory_block((U32)k_release_memory_block, p_mem_blk)
@@ -90,12 +107,144 @@ extern int k_send_message(int pid, void *p_msg);
 #define send_message(pid, p_msg) _send_message((U32)k_send_message, pid, p_msg)
 extern int _send_message(U32 p_func, int pid, void *p_msg) __SVC_0;
 
+/* never switches processes, call release_processor() when done sending.
+   With notify set, get_delivered_count() counts it once it is received */
+extern int k_send_message_async(int pid, void *p_msg, int notify);
+#define send_message_async(pid, p_msg, notify) _send_message_async((U32)k_send_message_async, pid, p_msg, notify)
+extern int _send_message_async(U32 p_func, int pid, void *p_msg, int notify) __SVC_0;
+
+extern int k_get_delivered_count(void);
+#define get_delivered_count() _get_delivered_count((U32)k_get_delivered_count)
+extern int _get_delivered_count(U32 p_func) __SVC_0;
+
+/* fails instead of blocking when the receiver's mailbox is full */
+extern int k_try_send_message(int pid, void *p_msg);
+#define try_send_message(pid, p_msg) _try_send_message((U32)k_try_send_message, pid, p_msg)
+extern int _try_send_message(U32 p_func, int pid, void *p_msg) __SVC_0;
+
+/* at most limit messages wait in pid's mailbox, senders block beyond that. 0 for no limit */
+extern int k_set_mailbox_limit(int pid, int limit);
+#define set_mailbox_limit(pid, limit) _set_mailbox_limit((U32)k_set_mailbox_limit, pid, limit)
+extern int _set_mailbox_limit(U32 p_func, int pid, int limit) __SVC_0;
+
+/* received before any normal message waiting in the mailbox */
+extern int k_send_message_urgent(int pid, void *p_msg);
+#define send_message_urgent(pid, p_msg) _send_message_urgent((U32)k_send_message_urgent, pid, p_msg)
+extern int _send_message_urgent(U32 p_func, int pid, void *p_msg) __SVC_0;
+
 extern void *k_receive_message(int *p_pid);
 #define receive_message(p_pid) _receive_message((U32)k_receive_message, p_pid)
 extern void *_receive_message(U32 p_func, void *p_pid) __SVC_0;
 
-/* Timing Service */
+/* named topics, a published message goes to every subscriber without copying.
+   Subscribers get read-only shared blocks when there is more than one */
+extern int k_subscribe(char *name, int pid);
+#define subscribe(name, pid) _subscribe((U32)k_subscribe, name, pid)
+extern int _subscribe(U32 p_func, char *name, int pid) __SVC_0;
+
+extern int k_unsubscribe(char *name, int pid);
+#define unsubscribe(name, pid) _unsubscribe((U32)k_unsubscribe, name, pid)
+extern int _unsubscribe(U32 p_func, char *name, int pid) __SVC_0;
+
+extern int k_publish(char *name, void *p_msg);
+#define publish(name, p_msg) _publish((U32)k_publish, name, p_msg)
+extern int _publish(U32 p_func, char *name, void *p_msg) __SVC_0;
+
+/* n messages in one system call, msgs is an array of message pointers */
+extern int k_send_message_batch(int pid, void **msgs, int n);
+#define send_message_batch(pid, msgs, n) _send_message_batch((U32)k_send_message_batch, pid, msgs, n)
+extern int _send_message_batch(U32 p_func, int pid, void **msgs, int n) __SVC_0;
+
+/* waits for a message, then returns up to max of them, senders may be NULL */
+extern int k_receive_message_batch(void **msgs, int *senders, int max);
+#define receive_message_batch(msgs, senders, max) _receive_message_batch((U32)k_receive_message_batch, msgs, senders, max)
+extern int _receive_message_batch(U32 p_func, void **msgs, int *senders, int max) __SVC_0;
+
+/* send a request and wait for the receiver to reply() to it */
+extern void *k_send_receive(int pid, void *p_msg);
+#define send_receive(pid, p_msg) _send_receive((U32)k_send_receive, pid, p_msg)
+extern void *_send_receive(U32 p_func, int pid, void *p_msg) __SVC_0;
+
+extern int k_reply(int pid, void *p_msg);
+#define reply(pid, p_msg) _reply((U32)k_reply, pid, p_msg)
+extern int _reply(U32 p_func, int pid, void *p_msg) __SVC_0;
+
+/* skips, but keeps, messages that are not of mtype or not from sender */
+extern void *k_receive_message_filtered(int *p_pid, int mtype, int sender);
+#define receive_message_filtered(p_pid, mtype, sender) _receive_message_filtered((U32)k_receive_message_filtered, p_pid, mtype, sender)
+extern void *_receive_message_filtered(U32 p_func, void *p_pid, int mtype, int sender) __SVC_0;
+
+/* returns NULL if no message arrives within ticks */
+extern void *k_receive_message_timeout(int *p_pid, int ticks);
+#define receive_message_timeout(p_pid, ticks) _receive_message_timeout((U32)k_receive_message_timeout, p_pid, ticks)
+extern void *_receive_message_timeout(U32 p_func, void *p_pid, int ticks) __SVC_0;
+
+extern int k_send_message_multi(int *pids, int num_pids, void *p_msg);
+#define send_message_multi(pids, num_pids, p_msg) _send_message_multi((U32)k_send_message_multi, pids, num_pids, p_msg)
+extern int _send_message_multi(U32 p_func, int *pids, int num_pids, void *p_msg) __SVC_0;
+
+/* mtext of a block whose length was never set holds NUL-terminated text */
+#define MSG_LEN_TEXT -2 /* not RTX_ERR, so it can not be mistaken for an invalid block */
+
+extern int k_set_message_length(void *p_msg, int length);
+#define set_message_length(p_msg, length) _set_message_length((U32)k_set_message_length, p_msg, length)
+extern int _set_message_length(U32 p_func, void *p_msg, int length) __SVC_0;
+
+extern int k_get_message_length(void *p_msg);
+#define get_message_length(p_msg) _get_message_length((U32)k_get_message_length, p_msg)
+extern int _get_message_length(U32 p_func, void *p_msg) __SVC_0;
+
+extern int k_get_message_capacity(void);
+#define get_message_capacity() _get_message_capacity((U32)k_get_message_capacity)
+extern int _get_message_capacity(U32 p_func) __SVC_0;
+
+/* Timing Service, RTX_ERR once NUM_TIMERS messages are pending, the caller keeps the block */
 extern int k_delayed_send(int pid, void *p_msg, int delay);
 #define delayed_send(pid, p_msg, delay) _delayed_send((U32)k_delayed_send, pid, p_msg, delay)
 extern int _delayed_send(U32 p_func, int pid, void *p_msg, int delay) __SVC_0;  
+
+extern int k_delayed_send_at(int pid, void *p_msg, int send_time);
+#define delayed_send_at(pid, p_msg, send_time) _delayed_send_at((U32)k_delayed_send_at, pid, p_msg, send_time)
+extern int _delayed_send_at(U32 p_func, int pid, void *p_msg, int send_time) __SVC_0;
+
+/* delay in microseconds rather than ticks */
+extern int k_delayed_send_us(int pid, void *p_msg, int delay_us);
+#define delayed_send_us(pid, p_msg, delay_us) _delayed_send_us((U32)k_delayed_send_us, pid, p_msg, delay_us)
+extern int _delayed_send_us(U32 p_func, int pid, void *p_msg, int delay_us) __SVC_0;
+
+extern int k_get_system_time(void);
+#define get_system_time() _get_system_time((U32)k_get_system_time)
+extern int _get_system_time(U32 p_func) __SVC_0;
+
+/* the %W wall clock, kept by the RTC */
+extern int k_set_wall_clock(int seconds);
+#define set_wall_clock(seconds) _set_wall_clock((U32)k_set_wall_clock, seconds)
+extern int _set_wall_clock(U32 p_func, int seconds) __SVC_0;
+
+extern int k_stop_wall_clock(void);
+#define stop_wall_clock() _stop_wall_clock((U32)k_stop_wall_clock)
+extern int _stop_wall_clock(U32 p_func) __SVC_0;
+
+/* RTX_ERR unless built with DEBUG_MAILBOX */
+extern int k_get_mailbox_stats(int pid, MAILBOX_STATS *stats);
+#define get_mailbox_stats(pid, stats) _get_mailbox_stats((U32)k_get_mailbox_stats, pid, stats)
+extern int _get_mailbox_stats(U32 p_func, int pid, MAILBOX_STATS *stats) __SVC_0;
+
+extern int k_get_timer_stats(TIMER_STATS *stats);
+#define get_timer_stats(stats) _get_timer_stats((U32)k_get_timer_stats, stats)
+extern int _get_timer_stats(U32 p_func, TIMER_STATS *stats) __SVC_0;
+
+/* delayed_send returns a handle for these, they fail once the message has been sent */
+extern void *k_cancel_delayed_send(int handle);
+#define cancel_delayed_send(handle) _cancel_delayed_send((U32)k_cancel_delayed_send, handle)
+extern void *_cancel_delayed_send(U32 p_func, int handle) __SVC_0;
+
+extern int k_rearm_delayed_send(int handle, int delay);
+#define rearm_delayed_send(handle, delay) _rearm_delayed_send((U32)k_rearm_delayed_send, handle, delay)
+extern int _rearm_delayed_send(U32 p_func, int handle, int delay) __SVC_0;
+
+/* later delayed messages of the caller may go out up to slack ticks late */
+extern int k_set_timer_slack(int slack);
+#define set_timer_slack(slack) _set_timer_slack((U32)k_set_timer_slack, slack)
+extern int _set_timer_slack(U32 p_func, int slack) __SVC_0;
 #endif /* !RTX_H_ */
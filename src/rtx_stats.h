@@ -0,0 +1,24 @@
+#ifndef RTX_STATS_H_
+#define RTX_STATS_H_
+
+/* How late delayed messages went out, in ticks past the deadline they
+   were sent for. Timer slack counts as lateness. */
+typedef struct timer_stats
+{
+	int count;          /* messages sent */
+	int late;           /* messages sent after their deadline */
+	int max_lateness;
+	int total_lateness; /* divide by count for the average */
+} TIMER_STATS;
+
+/* Traffic through a mailbox, collected in builds with DEBUG_MAILBOX */
+typedef struct mailbox_stats
+{
+	int sent;           /* messages the process sent */
+	int received;       /* messages it received */
+	int max_depth;      /* most messages its mailbox held */
+	int avg_latency;    /* microseconds a message waited in its mailbox */
+	int max_latency;
+} MAILBOX_STATS;
+
+#endif
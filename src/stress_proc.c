@@ -73,33 +73,14 @@ void procB(void)
   }
 }
 
-envelope* msg_buf_to_envelope(MSG_BUF* msg) {
-	return ((envelope*) msg) - 1;
-}
-
-MSG_BUF* envelope_to_msg_buf(envelope* env) {
-	return (MSG_BUF*) (env + 1);
-}
-
 void procC(void)
 {
-	envelope* msg_q_head = NULL;
-	envelope* msg_q_tail = NULL;
 	MSG_BUF* p;
 	int sender_id;
 	
   while (1) {
-    if (msg_q_head == NULL) {
-			p = (MSG_BUF*) receive_message(&sender_id);
-			uart1_put_string("C receive new message\n\r");
-		}
-		else {
-			p = envelope_to_msg_buf(msg_q_head);
-			msg_q_head = msg_q_head->next;
-			if (msg_q_head == NULL) {
-				msg_q_tail = NULL;
-			}
-		}
+		p = (MSG_BUF*) receive_message(&sender_id);
+		uart1_put_string("C receive new message\n\r");
 		
 		if (p->mtype == COUNT_REPORT && (p->mtext[0] % 20 == 0)) {
 			p->mtype = DEFAULT;
@@ -108,29 +89,17 @@ void procC(void)
 			
 			MSG_BUF* q = (MSG_BUF*) request_memory_block();
 			q->mtype = WAKEUP10;
-			delayed_send(PID_C, (void*) q, 10000);
 			
 			uart1_put_string("C request memory block\n\r");
 			
-			while (1) {
-				p = (MSG_BUF*) receive_message(&sender_id);
-				uart1_put_string("C queue message\n\r");
-				if (p->mtype == WAKEUP10) {
-					break;
-				}
-				else {
-					envelope* env = msg_buf_to_envelope(p);
-					env->next = NULL;
-					if (msg_q_tail == NULL) {
-						msg_q_tail = env;
-						msg_q_head = env;
-					}
-					else {
-						msg_q_tail->next = env;
-						msg_q_tail = env;
-					}
-				}
-			}			
+			if (delayed_send(PID_C, (void*) q, 10000) == RTX_ERR) {
+				// no timer free for the wakeup, skip the hibernation
+				p = q;
+			}
+			else {
+				// hibernate, messages arriving meanwhile stay queued in the mailbox
+				p = (MSG_BUF*) receive_message_filtered(&sender_id, WAKEUP10, PID_C);
+			}
 		}
 		release_memory_block((void*) p);
 		uart1_put_string("C memory released\n\r");
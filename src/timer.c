@@ -14,9 +14,30 @@
 
 #define BIT(X) (1<<X)
 
+/* Cortex-M3 debug registers behind the cycle counter, see the ARMv7-M ARM C1.8 */
+#define DEMCR               (*(volatile uint32_t *) 0xE000EDFC)
+#define DEMCR_TRCENA        BIT(24)
+#define DWT_CTRL            (*(volatile uint32_t *) 0xE0001000)
+#define DWT_CTRL_CYCCNTENA  BIT(0)
+#define DWT_CTRL_NOCYCCNT   BIT(25)
+#define DWT_CYCCNT          (*(volatile uint32_t *) 0xE0001004)
+
 volatile uint32_t g_timer_count = 0; // increment every 1 ms
+volatile uint32_t g_timer_count_hi = 0; // times g_timer_count wrapped
+#ifdef TIMER1_PROFILE
 volatile uint32_t g_timer2_count = 0;
-timerQ Q;
+#endif /* TIMER1_PROFILE */
+volatile uint32_t g_cycles_hi = 0;   // times CYCCNT wrapped
+volatile uint32_t g_cycles_last = 0; // CYCCNT as of the last tick
+int g_has_cyccnt = 0;                // 0 if the clock falls back on TIMER0
+uint32_t g_cycles_per_tick;
+timerLink wheel[WHEEL_LEVELS][WHEEL_SLOTS]; /* delayed messages, level n slots span WHEEL_SLOTS^n ticks */
+uint32_t wheel_next = 0;                    /* next tick the wheel will expire */
+timerLink fineTimers;                       /* sub-tick messages due this tick, by offset_us, MR1 fires for the first */
+timerEntry timers[NUM_TIMERS];
+timerEntry* freeTimers = NULL;
+uint32_t lastSlackTick = 0;                 /* tick timer_slack picked last */
+TIMER_STATS timer_stats;                    /* how late delayed messages went out */
 extern int exists_higher_priority_ready_process(void);
 
 
@@ -25,9 +46,6 @@ extern int exists_higher_priority_ready_process(void);
  */
 uint32_t timer_init(uint8_t n_timer) 
 {
-	Q.head = NULL;
-	Q.tail = NULL;
-	
 	LPC_TIM_TypeDef *pTimer;
 	if (n_timer == 0) {
 		/*
@@ -62,13 +80,40 @@ uint32_t timer_init(uint8_t n_timer)
 		*/
 		pTimer = (LPC_TIM_TypeDef *) LPC_TIM0;
 		
-		g_timer_count = 0;
+		g_timer_count = TIMER_INITIAL_COUNT;
+		g_timer_count_hi = 0;
+		
+		for (int level = 0; level < WHEEL_LEVELS; level++) {
+			for (int slot = 0; slot < WHEEL_SLOTS; slot++) {
+				wheel[level][slot].next = &wheel[level][slot];
+				wheel[level][slot].prev = &wheel[level][slot];
+			}
+		}
+		wheel_next = g_timer_count;
+		fineTimers.next = &fineTimers;
+		fineTimers.prev = &fineTimers;
+		
+		timer_stats.count = 0;
+		timer_stats.late = 0;
+		timer_stats.max_lateness = 0;
+		timer_stats.total_lateness = 0;
+		
+		freeTimers = NULL;
+		for (int i = NUM_TIMERS - 1; i >= 0; i--) {
+			timers[i].env = NULL;
+			timers[i].handle = i;
+			timers[i].link.next = (timerLink*) freeTimers;
+			freeTimers = &timers[i];
+		}
 
 	} else { /* other timer not supported yet */
-		
+#ifdef TIMER1_PROFILE
 		pTimer = (LPC_TIM_TypeDef *) LPC_TIM1;
 		
 		g_timer2_count = 0;
+#else
+		return 1;
+#endif /* TIMER1_PROFILE */
 	}
 
 	/*
@@ -79,7 +124,8 @@ uint32_t timer_init(uint8_t n_timer)
 
 	/* Step 4.1: Prescale Register PR setting 
 	   CCLK = 100 MHZ, PCLK = CCLK/4 = 25 MHZ
-	   2*(12499 + 1)*(1/25) * 10^(-6) s = 10^(-3) s = 1 ms
+	   (24 + 1)*(1/25) * 10^(-6) s = 1 microsecond per TC count,
+	   TICK_US counts make the 1 ms tick
 		 2*(12 + 1)*(1/25) * 10^(-6) s = 10^(-3) s = 1.04 microseconds
 	   Memory Timing:
 			0x88 cycles of timer1 to request memory 70 times
@@ -90,25 +136,41 @@ uint32_t timer_init(uint8_t n_timer)
 	   Receive Message Timing:
 			116 cycles to receive 70 messages
 			This is 120.64 microseconds total, 1.72 microseconds per receive
+	   The memory timing predates memStack, it was taken on the FIFO free
+	   list. Releases have not been timed on the board yet, so there are no
+	   numbers for the LIFO either way, see the release timing proc in
+	   usr_proc.c.
+	   The send timing is to a receiver that is not waiting. Sends that
+	   hand off to a waiting higher-priority receiver have not been timed,
+	   so it is not known whether the handoff is faster than the scheduler,
+	   see the handoff timing procs in usr_proc.c.
 			
 			
-	   TC (Timer Counter) toggles b/w 0 and 1 every 12500 PCLKs
+	   TC (Timer Counter) of TIMER0 runs from 0 to TICK_US - 1,
+	   TC of TIMER1 toggles b/w 0 and 1 every 13 PCLKs
 	   see MR setting below 
 	*/
 	if (n_timer == 0){
-	    pTimer->PR = 12499;
+	    pTimer->PR = 24;
 	}
 	else {
 	    pTimer->PR = 12;
 	}
 
 	/* Step 4.2: MR setting, see section 21.6.7 on pg496 of LPC17xx_UM. */
-	pTimer->MR0 = 1;
+	if (n_timer == 0){
+	    pTimer->MR0 = TICK_US - 1;
+	}
+	else {
+	    pTimer->MR0 = 1;
+	}
 
 	/* Step 4.3: MCR setting, see table 429 on pg496 of LPC17xx_UM.
 	   Interrupt on MR0: when MR0 mathches the value in the TC, 
 	                     generate an interrupt.
 	   Reset on MR0: Reset TC if MR0 mathches it.
+	   TIMER0 also interrupts on MR1 (BIT(3)) while sub-tick messages
+	   are pending, see timer_fine_expire.
 	*/
 	pTimer->MCR = BIT(0) | BIT(1);
 
@@ -135,6 +197,7 @@ uint32_t timer_init(uint8_t n_timer)
  *       push and pop instructions in the assembly routine. 
  *       The actual c_TIMER0_IRQHandler does the rest of irq handling
  */
+#ifndef HOST_TEST /* host/timer_wheel_test.c calls c_TIMER0_IRQHandler itself */
 __asm void TIMER0_IRQHandler(void)
 {
 	PRESERVE8
@@ -149,7 +212,9 @@ __asm void TIMER0_IRQHandler(void)
 	;BL k_release_processor
 	POP{r4-r11, pc}
 }
+#endif /* HOST_TEST */
 
+#ifdef TIMER1_PROFILE
 __asm void TIMER1_IRQHandler(void) {
 	PRESERVE8
 	IMPORT c_TIMER1_IRQHandler
@@ -162,6 +227,7 @@ void c_TIMER1_IRQHandler(void) {
 	LPC_TIM1->IR = BIT(0);  
 	g_timer2_count++;
 }
+#endif /* TIMER1_PROFILE */
 
 
 
@@ -170,25 +236,31 @@ void c_TIMER1_IRQHandler(void) {
  */
 void c_TIMER0_IRQHandler(void)
 {
+	uint32_t ir = LPC_TIM0->IR;
+	
 	/* ack inttrupt, see section  21.6.1 on pg 493 of LPC17XX_UM */
-	LPC_TIM0->IR = BIT(0);  
-	g_timer_count++;
+	LPC_TIM0->IR = ir & (BIT(0) | BIT(1));
 	
-	envelope* env;
-  while (1){
-		env = k_receive_message_non_blocking(PID_TIMER_IPROC);
-		if (env == NULL) {
-			break;
+	if (ir & BIT(0)) {
+		g_timer_count++;
+		if (g_timer_count == 0) {
+			g_timer_count_hi++;
 		}
-		//place envelope in queue sorted by send time
-		timer_insert(env);
-	}
-	//send messages in queue that have expired
-	while (message_ready()){
-		env = timer_dequeue();
-		timer_send_message(env);
+		clock_tick();
+		
+		//sub-tick messages of the last tick whose MR1 match was missed
+		timer_fine_flush();
+		
+		//send messages in the wheel that have expired
+		timer_expire(g_timer_count);
+		
+		//wake processes whose timed waits ran out
+		timedWaitTick(g_timer_count);
 	}
 	
+	//send sub-tick messages TC has reached, MR1 goes to the next one
+	timer_fine_expire();
+	
 	if (exists_higher_priority_ready_process()) {
 		k_release_processor();
 		//uart1_put_string("timer release processor");
@@ -207,68 +279,488 @@ uint32_t get_time(void)
 }
 
 /**
- * @brief: insert envelope into queue (in sorted order)
+ * @brief: Returns current time as 64 bits, it does not wrap for 584 million years
  */
-void timer_insert(envelope* env)
-{
-	//iterate, insert envelope when the next envelope's send time is later
-	envelope* curr = Q.head;
-	envelope* next = curr->next;
-
-	//case when queue is empty
-	if (curr == NULL){
-		Q.head = env;
-		Q.tail = env;
-		env->next = NULL;
-		return;
-	}
-	//case when inserting at the front
-	if (env->send_time <= curr->send_time){
-		Q.head = env;
-		env->next = curr;
-		return;
-	}
-	//else
-	while(1){
-		if (next == NULL){
-			curr->next = env;
-			env->next = NULL;
-			Q.tail = env;
-			break;
-		}
-		if (env->send_time <= next->send_time){
-			curr->next = env;
-			env->next = next;
-			break;
+uint64_t get_time64(void)
+{
+	uint32_t hi;
+	uint32_t lo;
+
+	//retry if the tick handler wrapped the low word under us
+	do {
+		hi = g_timer_count_hi;
+		lo = g_timer_count;
+	} while (hi != g_timer_count_hi);
+	return ((uint64_t) hi << 32) | lo;
+}
+
+/**
+ * @brief: starts the DWT cycle counter behind clock_cycles(). Falls back on
+ *         TIMER0 if the core has no cycle counter or it does not run (the
+ *         simulator may not model it).
+ */
+void clock_init(void)
+{
+	volatile int i;
+	uint32_t start;
+
+	g_cycles_per_tick = SystemFrequency / 1000;
+	g_cycles_hi = 0;
+	g_cycles_last = 0;
+	g_has_cyccnt = 0;
+
+	DEMCR |= DEMCR_TRCENA;
+	if (!(DWT_CTRL & DWT_CTRL_NOCYCCNT)) {
+		DWT_CYCCNT = 0;
+		DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+
+		start = DWT_CYCCNT;
+		for (i = 0; i < 16; i++);
+		g_has_cyccnt = DWT_CYCCNT != start;
+	}
+}
+
+/**
+ * @brief: called every tick so clock_cycles() can tell when CYCCNT wrapped.
+ *         CYCCNT wraps every 42 s at 100 MHz, so it never wraps twice unseen.
+ */
+void clock_tick(void)
+{
+	uint32_t cycles;
+
+	if (g_has_cyccnt) {
+		cycles = DWT_CYCCNT;
+		if (cycles < g_cycles_last) {
+			g_cycles_hi++;
 		}
-		curr = next;
-		next = curr->next;
+		g_cycles_last = cycles;
 	}
 }
 
 /**
- * @brief: return first envelope into queue
+ * @brief: Returns CPU cycles since clock_init(). Monotonic and needs no system call.
  */
-envelope* timer_dequeue( void )
+uint64_t clock_cycles(void)
 {
-	//standard dequeue
-	envelope* env = Q.head;
-	Q.head = env->next;
-	env->next = NULL;
-	
-	if (Q.head == NULL){
-		Q.tail = NULL;
+	uint32_t hi;
+	uint32_t last;
+	uint32_t cycles;
+	uint64_t ticks;
+	uint32_t tc;
+
+	if (!g_has_cyccnt) {
+		//whole ticks, plus how far TIMER0 has counted towards the next one
+		do {
+			ticks = get_time64() - TIMER_INITIAL_COUNT;
+			tc = LPC_TIM0->TC;
+		} while (ticks != get_time64() - TIMER_INITIAL_COUNT);
+		return ticks * g_cycles_per_tick + (uint64_t) tc * g_cycles_per_tick / (LPC_TIM0->MR0 + 1);
 	}
-	
+
+	//retry if the tick handler updated the high word under us
+	do {
+		hi = g_cycles_hi;
+		last = g_cycles_last;
+		cycles = DWT_CYCCNT;
+	} while (hi != g_cycles_hi);
+
+	if (cycles < last) {
+		hi++; //wrapped since the last tick
+	}
+	return ((uint64_t) hi << 32) | cycles;
+}
+
+/**
+ * @brief: Returns microseconds since clock_init()
+ */
+uint64_t clock_us(void)
+{
+	return clock_cycles_to_us(clock_cycles());
+}
+
+/**
+ * @brief: Returns TIMER0 ticks, get_time() without the wrap
+ */
+uint64_t clock_ticks(void)
+{
+	return get_time64();
+}
+
+uint64_t clock_cycles_to_us(uint64_t cycles)
+{
+	return cycles * 1000 / g_cycles_per_tick;
+}
+
+uint32_t clock_cycles_to_ticks(uint64_t cycles)
+{
+	return (uint32_t) (cycles / g_cycles_per_tick);
+}
+
+/**
+ * @brief: Returns current time, for user processes
+ */
+int k_get_system_time(void)
+{
+	return get_time();
+}
+
+/**
+ * @brief: insert entry into the timing wheel slot covering its expiry.
+ *         Slots of level 0 hold a single tick, slots of higher levels are
+ *         cascaded down a level when the level below wraps around.
+ */
+void timer_insert(timerEntry* entry)
+{
+	uint32_t expires = entry->expires;
+	uint32_t delta;
+	int level;
+	timerLink* slot;
+
+	//expiry already passed, expire it on the next tick
+	if (TIME_BEFORE(expires, wheel_next)) {
+		expires = wheel_next;
+	}
+	delta = expires - wheel_next;
+
+	//beyond the wheel, park it in the last slot, it is re-filed when cascaded
+	if (delta >= WHEEL_RANGE) {
+		delta = WHEEL_RANGE - 1;
+		expires = wheel_next + delta;
+	}
+
+	for (level = 0; delta >= (1u << (WHEEL_BITS * (level + 1))); level++);
+	slot = &wheel[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK];
+
+	entry->link.next = slot;
+	entry->link.prev = slot->prev;
+	slot->prev->next = &entry->link;
+	slot->prev = &entry->link;
+}
+
+/**
+ * @brief: takes entry out of its wheel slot
+ */
+void timer_unlink(timerEntry* entry)
+{
+	entry->link.prev->next = entry->link.next;
+	entry->link.next->prev = entry->link.prev;
+}
+
+/**
+ * @brief: empties a slot
+ * @return: its entries as a NULL-terminated list, chained through link.next
+ */
+timerLink* timer_take_slot(timerLink* slot)
+{
+	timerLink* first = slot->next;
+
+	if (first == slot) {
+		return NULL;
+	}
+	slot->prev->next = NULL;
+	slot->next = slot;
+	slot->prev = slot;
+	return first;
+}
+
+/**
+ * @brief: picks the tick in [expires, expires + slack] a message goes out on,
+ *         in constant time since it runs with interrupts masked. It joins the
+ *         tick it picked last if that is in the window, so back-to-back
+ *         senders share a tick. Otherwise it takes the tick in the window with
+ *         the most trailing zero bits, which every window holding that tick
+ *         rounds to as well. Overlapping windows can still pick different
+ *         ticks: [3,5] takes 4, then [5,7] takes 6.
+ */
+uint32_t timer_slack(uint32_t expires, uint32_t slack)
+{
+	uint32_t limit = expires + slack;
+	uint32_t mask = expires ^ limit;
+	int bit = 31;
+
+	if (slack == 0) {
+		return expires;
+	}
+	if (TIME_AFTER_EQ(lastSlackTick, expires) && TIME_AFTER_EQ(limit, lastSlackTick)) {
+		return lastSlackTick;
+	}
+	//clear limit below the highest bit it differs from expires in
+	while (!(mask & (1u << bit))) {
+		bit--;
+	}
+	mask = (1u << bit) - 1;
+	lastSlackTick = limit & ~mask;
+	return lastSlackTick;
+}
+
+/**
+ * @brief: schedules env to be sent once deadline has passed, or up to slack
+ *         ticks later, see timer_slack
+ * @return: a handle for timer_lookup, or RTX_ERR if all NUM_TIMERS are in use
+ */
+int timer_add(envelope* env, int recv_id, uint32_t deadline, uint32_t slack)
+{
+	int handle = timer_add_fine(env, recv_id, timer_slack(deadline, slack), 0);
+
+	if (handle != RTX_ERR) {
+		timer_lookup(handle)->deadline = deadline;
+	}
+	return handle;
+}
+
+/**
+ * @brief: schedules env to be sent offset_us microseconds into tick expires.
+ *         It waits in the wheel until that tick, then on fineTimers for MR1.
+ * @return: a handle for timer_lookup, or RTX_ERR if all NUM_TIMERS are in use
+ */
+int timer_add_fine(envelope* env, int recv_id, uint32_t expires, uint32_t offset_us)
+{
+	timerEntry* entry = freeTimers;
+
+	if (entry == NULL) {
+		return RTX_ERR;
+	}
+	freeTimers = (timerEntry*) entry->link.next;
+
+	//a new handle every time the entry is reused, so stale handles don't match
+	if (entry->handle > 0x7FFFFFFF - NUM_TIMERS) {
+		entry->handle = entry - timers;
+	}
+	entry->handle += NUM_TIMERS;
+	entry->env = env;
+	entry->recv_id = recv_id;
+	entry->deadline = expires;
+	entry->expires = expires;
+	entry->offset_us = offset_us;
+	if (offset_us != 0 && expires == g_timer_count) {
+		timer_fine_insert(entry);
+		timer_fine_expire();
+	} else {
+		timer_insert(entry);
+	}
+	return entry->handle;
+}
+
+/**
+ * @brief: schedules env to be sent delay_us microseconds from now
+ * @return: a handle for timer_lookup, or RTX_ERR if all NUM_TIMERS are in use
+ */
+int timer_add_us(envelope* env, int recv_id, uint32_t delay_us)
+{
+	uint32_t tick = g_timer_count;
+	uint32_t tc = LPC_TIM0->TC;
+
+	//MR0 matched but the tick interrupt has not run yet, TC is in the next tick
+	if (LPC_TIM0->IR & BIT(0)) {
+		tick++;
+		tc = LPC_TIM0->TC;
+	}
+	tc += delay_us;
+	return timer_add_fine(env, recv_id, tick + tc / TICK_US, tc % TICK_US);
+}
+
+/**
+ * @brief: puts entry back on the free list, its handle goes stale
+ */
+void timer_free(timerEntry* entry)
+{
+	entry->env = NULL;
+	entry->link.next = (timerLink*) freeTimers;
+	freeTimers = entry;
+}
+
+/**
+ * @brief: finds the pending entry of a handle
+ * @return: the entry, or NULL if the handle is invalid or its message went out
+ */
+timerEntry* timer_lookup(int handle)
+{
+	timerEntry* entry;
+
+	if (handle < NUM_TIMERS) {
+		return NULL;
+	}
+	entry = &timers[handle % NUM_TIMERS];
+	if (entry->handle != handle || entry->env == NULL) {
+		return NULL;
+	}
+	return entry;
+}
+
+/**
+ * @brief: takes a pending message out of the wheel
+ * @return: its envelope
+ */
+envelope* timer_cancel(timerEntry* entry)
+{
+	envelope* env = entry->env;
+
+	timer_unlink(entry);
+	timer_free(entry);
 	return env;
 }
 
 /**
- * @brief: return whether the message on top of queue should be sent
+ * @brief: moves a pending message to a new deadline, keeping its handle
+ */
+void timer_rearm(timerEntry* entry, uint32_t deadline, uint32_t slack)
+{
+	timer_unlink(entry);
+	entry->deadline = deadline;
+	entry->expires = timer_slack(deadline, slack);
+	entry->offset_us = 0;
+	timer_insert(entry);
+}
+
+/**
+ * @brief: re-files every entry of a slot into the levels below it
+ * @return: index
+ */
+int timer_cascade(int level, int index)
+{
+	timerLink* link = timer_take_slot(&wheel[level][index]);
+	timerLink* next;
+
+	while (link != NULL) {
+		next = link->next;
+		timer_insert((timerEntry*) link);
+		link = next;
+	}
+	return index;
+}
+
+/**
+ * @brief: records how late a delayed message goes out, against the deadline
+ *         it was sent for rather than the expiry slack picked
  */
-int message_ready( void )
+void timer_record_lateness(timerEntry* entry)
 {
-	//Returns 1 if the first message on a queue exists and has a send time
-	//earlier than current time
-	return Q.head != NULL && Q.head->send_time < get_time();
+	int lateness = (int) (g_timer_count - entry->deadline);
+
+	timer_stats.count++;
+	if (lateness > 0) {
+		timer_stats.late++;
+		timer_stats.total_lateness += lateness;
+		if (lateness > timer_stats.max_lateness) {
+			timer_stats.max_lateness = lateness;
+		}
+	}
+}
+
+/**
+ * @brief: copies the lateness statistics of delayed messages into stats
+ */
+int k_get_timer_stats(TIMER_STATS* stats)
+{
+	*stats = timer_stats;
+	return RTX_OK;
+}
+
+/**
+ * @brief: inserts entry into fineTimers, ordered by offset_us
+ */
+void timer_fine_insert(timerEntry* entry)
+{
+	timerLink* pos = fineTimers.next;
+
+	while (pos != &fineTimers && ((timerEntry*) pos)->offset_us <= entry->offset_us) {
+		pos = pos->next;
+	}
+	entry->link.next = pos;
+	entry->link.prev = pos->prev;
+	pos->prev->next = &entry->link;
+	pos->prev = &entry->link;
+}
+
+/**
+ * @brief: sends a message off fineTimers
+ */
+void timer_fine_send(timerEntry* entry)
+{
+	envelope* env = entry->env;
+	int recv_id = entry->recv_id;
+
+	timer_unlink(entry);
+	timer_record_lateness(entry);
+	timer_free(entry);
+	timer_send_message(recv_id, env);
+}
+
+/**
+ * @brief: sends every message on fineTimers whose offset TC has reached, then
+ *         points MR1 at the next one. There is no periodic interrupt below
+ *         the tick, MR1 only interrupts while fineTimers is not empty.
+ */
+void timer_fine_expire(void)
+{
+	timerEntry* entry;
+
+	while (fineTimers.next != &fineTimers) {
+		entry = (timerEntry*) fineTimers.next;
+		LPC_TIM0->MR1 = entry->offset_us;
+		LPC_TIM0->MCR |= BIT(3);
+
+		//TC can pass MR1 before it is set, then there is no match to wait for
+		if (LPC_TIM0->TC < entry->offset_us) {
+			return;
+		}
+		timer_fine_send(entry);
+	}
+	LPC_TIM0->MCR &= ~BIT(3);
+}
+
+/**
+ * @brief: sends everything left on fineTimers, called when a new tick starts
+ */
+void timer_fine_flush(void)
+{
+	while (fineTimers.next != &fineTimers) {
+		timer_fine_send((timerEntry*) fineTimers.next);
+	}
+}
+
+/**
+ * @brief: sends every message whose expiry is at or before now
+ */
+void timer_expire(uint32_t now)
+{
+	timerLink* link;
+	timerLink* next;
+	envelope* env;
+	int recv_id;
+	int index;
+	int level;
+
+	while (TIME_AFTER_EQ(now, wheel_next)) {
+		index = wheel_next & WHEEL_MASK;
+
+		//level 0 wrapped around, bring the next round down from the coarser levels
+		if (index == 0) {
+			for (level = 1; level < WHEEL_LEVELS; level++) {
+				if (timer_cascade(level, (wheel_next >> (WHEEL_BITS * level)) & WHEEL_MASK) != 0) {
+					break;
+				}
+			}
+		}
+
+		link = timer_take_slot(&wheel[0][index]);
+		wheel_next++;
+
+		while (link != NULL) {
+			next = link->next;
+			
+			//due within this tick, MR1 sends it
+			if (((timerEntry*) link)->offset_us != 0 && ((timerEntry*) link)->expires == now) {
+				timer_fine_insert((timerEntry*) link);
+				link = next;
+				continue;
+			}
+			env = ((timerEntry*) link)->env;
+			recv_id = ((timerEntry*) link)->recv_id;
+			timer_record_lateness((timerEntry*) link);
+			timer_free((timerEntry*) link);
+			timer_send_message(recv_id, env);
+			link = next;
+		}
+	}
 }
@@ -8,19 +8,74 @@
 
 #include <LPC17xx.h>
 #include "k_message.h"
+#include "rtx_stats.h"
 
-typedef struct timerQ timerQ;
-struct timerQ {
-    envelope* head;
-    envelope* tail;
+/* Delayed messages wait in a hierarchical timing wheel of WHEEL_LEVELS levels */
+#define WHEEL_BITS   5
+#define WHEEL_SLOTS  (1 << WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_RANGE  (1u << (WHEEL_BITS * WHEEL_LEVELS)) /* ticks the wheel spans */
+
+#define NUM_TIMERS 64 /* delayed messages that can be pending at once */
+
+#define TICK_US 1000 /* TIMER0 counts microseconds, MR0 ends the tick at TICK_US */
+
+/* Tick the clock starts at. Build with e.g. TIMER_INITIAL_COUNT=0xFFFFF000
+   to reach the 32-bit wrap a few seconds after boot */
+#ifndef TIMER_INITIAL_COUNT
+#define TIMER_INITIAL_COUNT 0
+#endif
+
+/* Compare 32-bit ticks across the wrap, valid while they are less than 2^31 apart */
+#define TIME_AFTER(a, b)    ((int32_t)((b) - (a)) < 0)
+#define TIME_AFTER_EQ(a, b) ((int32_t)((a) - (b)) >= 0)
+#define TIME_BEFORE(a, b)   TIME_AFTER(b, a)
+
+/* Wheel slots are circular lists with the slot itself as sentinel */
+typedef struct timerLink timerLink;
+struct timerLink {
+    timerLink* next;
+    timerLink* prev;
+};
+
+typedef struct timerEntry timerEntry;
+struct timerEntry {
+    timerLink link;    /* position in its wheel slot, must come first */
+    envelope* env;     /* the delayed message, NULL while the entry is free */
+    int recv_id;       /* who it goes to */
+    uint32_t deadline; /* tick the sender asked for */
+    uint32_t expires;  /* tick the message is due at, the deadline plus slack */
+    uint16_t offset_us;/* microseconds into that tick, 0 to go out on the tick */
+    int handle;        /* handle given out by delayed_send */
 };
 
 extern uint32_t timer_init ( uint8_t n_timer );  /* initialize timer n_timer */
 extern uint32_t get_time( void ); /* Get current time */
+extern uint64_t get_time64( void ); /* Get current time, never wraps */
+
+extern int timer_add( envelope* env, int recv_id, uint32_t deadline, uint32_t slack ); /* returns a handle or RTX_ERR */
+extern uint32_t timer_slack( uint32_t expires, uint32_t slack );
+extern int timer_add_fine( envelope* env, int recv_id, uint32_t expires, uint32_t offset_us );
+extern int timer_add_us( envelope* env, int recv_id, uint32_t delay_us );
+extern timerEntry* timer_lookup( int handle );           /* NULL once the message went out */
+extern envelope* timer_cancel( timerEntry* entry );
+extern void timer_rearm( timerEntry* entry, uint32_t deadline, uint32_t slack );
+extern void timer_expire( uint32_t now ); /* send messages due at or before now */
+extern void timer_fine_insert( timerEntry* entry );
+extern void timer_fine_expire( void ); /* send sub-tick messages TC has reached */
+extern void timer_fine_flush( void );
+extern int k_get_timer_stats( TIMER_STATS* stats );
 
-extern void timer_insert( envelope* );
-extern envelope* timer_dequeue( void );
-extern int message_ready( void );
+/* Monotonic clock from the DWT cycle counter, callable without a system call */
+extern void clock_init( void );
+extern void clock_tick( void );
+extern uint64_t clock_cycles( void );
+extern uint64_t clock_us( void );
+extern uint64_t clock_ticks( void );
+extern uint64_t clock_cycles_to_us( uint64_t cycles );
+extern uint32_t clock_cycles_to_ticks( uint64_t cycles );
+extern int k_get_system_time( void );
 extern uint32_t get_time(void) ;
 
 #endif /* ! _TIMER_H_ */
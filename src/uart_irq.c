@@ -214,7 +214,7 @@ void c_UART0_IRQHandler(void)
 		uart1_put_string("\n\r");
 #endif // DEBUG_0
 		
-		MSG_BUF* echoMsg = (MSG_BUF*) k_request_memory_block_non_blocking();
+		MSG_BUF* echoMsg = (MSG_BUF*) k_request_memory_block_reserved(PID_UART_IPROC);
 		if (echoMsg != NULL) {
 			echoMsg->mtype = ECHO;
 			if (g_char_in == '\r') {
@@ -233,7 +233,7 @@ void c_UART0_IRQHandler(void)
 		
 		
 		if (cur_msg == NULL) {
-			cur_msg = (MSG_BUF*) k_request_memory_block_non_blocking();
+			cur_msg = (MSG_BUF*) k_request_memory_block_reserved(PID_UART_IPROC);
 			// no more memory, return
 			if (cur_msg == NULL) {
 				return;
@@ -242,7 +242,7 @@ void c_UART0_IRQHandler(void)
 		}
 		
 		// if reached newline or if mtext out of space, send message
-		if (g_char_in == '\r' || msg_str_index > (BLOCK_SIZE - sizeof(envelope) - sizeof(MSG_BUF) - 10)) {
+		if (g_char_in == '\r' || msg_str_index >= MSG_CAPACITY - 1) {
 			#ifdef DEBUG_MEM
 			if (g_char_in != '\r') {
 				uart1_put_string("Message Size Overflow\n");
@@ -253,6 +253,7 @@ void c_UART0_IRQHandler(void)
 
 			copy->mtext[msg_str_index] = '\0';
 			copy->mtype = DEFAULT;
+			((envelope*) copy - 1)->length = msg_str_index;
 			
 			cur_msg = NULL;
 			msg_str_index = 0;
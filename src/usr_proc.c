@@ -14,7 +14,9 @@
 #include "printf.h"
 #endif /* DEBUG_0 */
 
-extern int g_timer2_count;
+extern MSG_BUF* pcbs_in_state (int state);
+
+typedef enum {NEW = 0, RDY, RUN, BLK, WAIT, WAIT_REPLY, BLK_SEND} PROC_STATE_E;
 
 /* initialization table item */
 PROC_INIT g_test_procs[NUM_TEST_PROCS];
@@ -25,6 +27,18 @@ int totalTests;
 
 int ready;
 
+/* test 5, send_receive() and reply() */
+int serverReady;      /* proc3 has tried to reply to a client that is not waiting */
+int requestReceived;  /* proc3 holds proc2's request, proc2 waits for the reply */
+int wrongServerTried; /* proc4 has tried to reply to proc2 */
+int replyNotWaiting;  /* the replies that had to fail did */
+int replyWrongServer;
+
+/* test 6, mailbox limits */
+int limitSet;         /* proc5's mailbox takes one message */
+int trySendFailed;    /* try_send_message() to the full mailbox failed */
+int secondSent;       /* proc4's send to the full mailbox went through */
+
 void set_test_procs() {
 	int i;
 	for( i = 0; i < NUM_TEST_PROCS; i++ ) {
@@ -44,8 +58,18 @@ void set_test_procs() {
 	
 	testsRan = 0;
 	testsPassed = 0;
-	totalTests = 3;
+	totalTests = 6;
 	ready = 0;
+	
+	serverReady = 0;
+	requestReceived = 0;
+	wrongServerTried = 0;
+	replyNotWaiting = 0;
+	replyWrongServer = 0;
+	
+	limitSet = 0;
+	trySendFailed = 0;
+	secondSent = 0;
 }
 
 // ONLY WORKS IF 0 <= testNumber < 10
@@ -62,6 +86,26 @@ void printTestStatus(int testNumber, int pass){
 	testsRan++;
 }
 
+/**
+ * @brief: whether process pid is in state, as the KCD hotkeys see it
+ */
+int inState(int pid, int state){
+	MSG_BUF* list = pcbs_in_state(state);
+	int found = 0;
+	
+	if (list == NULL){
+		return 0;
+	}
+	// "PID PRI\n\r", then a "pp r\n\r" line per process
+	for (char* line = list->mtext + 9; *line != '\0'; line += 6){
+		if ((line[0] - '0') * 10 + line[1] - '0' == pid){
+			found = 1;
+		}
+	}
+	release_memory_block(list);
+	return found;
+}
+
 /**
  * @brief: a process that prints results and yields the CPU if not done
  *         
@@ -97,17 +141,17 @@ void printTestStatus(int testNumber, int pass){
 	
 /*void proc1(void){ //Times Memory Requests
 	void* p;
-	int start_time;
+	U64 start_time;
 	int difference;
 	int average = 0;
 	
 	
-	start_time = g_timer2_count;
+	start_time = clock_cycles();
 	for (int i = 0; i < 70; i++){
 		p = (void*) request_memory_block();
 	}
 	
-	difference = g_timer2_count - start_time;
+	difference = (int) clock_cycles_to_us(clock_cycles() - start_time);
 	int temp = difference;
 	
 	uart1_put_char(difference);
@@ -115,9 +159,30 @@ void printTestStatus(int testNumber, int pass){
 	while (1);
 }*/
 
+/*void proc1(void){ //Times Memory Releases, not run on the board yet
+	void* p[70];
+	U64 start_time;
+	int difference;
+	
+	for (int i = 0; i < 70; i++){
+		p[i] = (void*) request_memory_block();
+	}
+	
+	start_time = clock_cycles();
+	for (int i = 0; i < 70; i++){
+		release_memory_block(p[i]);
+	}
+	
+	difference = (int) clock_cycles_to_us(clock_cycles() - start_time);
+	
+	uart1_put_char(difference);
+	
+	while (1);
+}*/
+
 /*void proc1(void){ //Times message sending
 	MSG_BUF* p[70];
-	int start_time;
+	U64 start_time;
 	int difference;
 	int average = 0;
 	
@@ -125,11 +190,11 @@ void printTestStatus(int testNumber, int pass){
 		p[i] = (MSG_BUF*) request_memory_block();
 	}
 	
-	start_time = g_timer2_count;
+	start_time = clock_cycles();
 	for (int i = 0; i < 70; i++){
 		send_message(PID_P2, p[i]);
 	}
-	difference = g_timer2_count - start_time;
+	difference = (int) clock_cycles_to_us(clock_cycles() - start_time);
 	
 	int temp = difference;
 	
@@ -140,7 +205,7 @@ void printTestStatus(int testNumber, int pass){
 
 /*void proc1(void){ //Times message receiving
 	MSG_BUF* p[70];
-	int start_time;
+	U64 start_time;
 	int difference;
 	int sender;
 	
@@ -153,11 +218,11 @@ void printTestStatus(int testNumber, int pass){
 		send_message(PID_P1, p[i]);
 	}
 	
-	start_time = g_timer2_count;
+	start_time = clock_cycles();
 	for (int i = 0; i < 70; i++){
 		receive_message(&sender);
 	}
-	difference = g_timer2_count - start_time;
+	difference = (int) clock_cycles_to_us(clock_cycles() - start_time);
 	
 	int temp = difference;
 	
@@ -166,6 +231,34 @@ void printTestStatus(int testNumber, int pass){
 	while (1);
 }*/
 
+/*void proc1(void){ //Receiver for the handoff timing below, must have the better priority. Not run on the board yet
+	int sender;
+	
+	while (1) {
+		release_memory_block(receive_message(&sender));
+	}
+}
+
+void proc2(void){ //Times message sending to a waiting higher-priority receiver
+	MSG_BUF* p[70];
+	U64 start_time;
+	int difference;
+	
+	for (int i = 0; i < 70; i++){
+		p[i] = (MSG_BUF*) request_memory_block();
+	}
+	
+	start_time = clock_cycles();
+	for (int i = 0; i < 70; i++){
+		send_message(PID_P1, p[i]);
+	}
+	difference = (int) clock_cycles_to_us(clock_cycles() - start_time);
+	
+	uart1_put_char(difference);
+	
+	while (1);
+}*/
+
 void proc2(void) {
 	
 	while (1){
@@ -195,6 +288,35 @@ void proc2(void) {
 	
 	release_memory_block(msg);
 	
+	//test 5: send_receive() gets the reply of the process it sent to
+	while (!serverReady){
+		release_processor();
+	}
+	
+	msg = (MSG_BUF*) request_memory_block();
+	msg->mtype = DEFAULT;
+	msg->mtext[0] = 'p';
+	msg->mtext[1] = 'i';
+	msg->mtext[2] = 'n';
+	msg->mtext[3] = 'g';
+	msg->mtext[4] = '\0';
+	
+	MSG_BUF* answer = (MSG_BUF*) send_receive(PID_P3, msg);
+	
+	if (answer == NULL || answer->mtext[0] != 'p' || answer->mtext[1] != 'o' || answer->mtext[2] != 'n' || answer->mtext[3] != 'g'){
+		printTestStatus(5, 0);
+	}
+	else if (!replyNotWaiting || !replyWrongServer){
+		printTestStatus(5, 0);
+	}
+	else {
+		printTestStatus(5, 1);
+	}
+	
+	if (answer != NULL){
+		release_memory_block(answer);
+	}
+	
 	while(1) {
 		release_processor();
 	}
@@ -229,6 +351,26 @@ void proc3(void) {
 	
 	send_message(2, msg);
 	
+	while (testsRan < 3) {
+		release_processor();
+	}
+	
+	//test 5: reply() fails unless the client is waiting on the caller
+	MSG_BUF* request = (MSG_BUF*) request_memory_block();
+	replyNotWaiting = reply(PID_P2, request) == RTX_ERR;
+	release_memory_block(request);
+	serverReady = 1;
+	
+	request = (MSG_BUF*) receive_message(&sender);
+	requestReceived = 1;
+	
+	while (!wrongServerTried) {
+		release_processor();
+	}
+	
+	request->mtext[1] = 'o';
+	reply(sender, request);
+	
 	while (1) {
 		release_processor();
 	}
@@ -273,36 +415,77 @@ void proc4(void) {
 	msg4->mtext[2] = '1';
 	msg4->mtext[3] = '\0';
 	
-	delayed_send(4, msg, 200);
-	delayed_send(4, msg2, 100);
-	delayed_send(4, msg3, 50);
-	delayed_send(4, msg4, 201);
-	
-	MSG_BUF* rec = receive_message(&sender);
-	MSG_BUF* rec2 = receive_message(&sender);
-	MSG_BUF* rec3 = receive_message(&sender);
-	MSG_BUF* rec4 = receive_message(&sender);
-	
-	if (rec->mtext[0] != '5' || rec->mtext[1] != '0'){
-		printTestStatus(2, 0);
-	}
-	else if (rec2->mtext[0] != '1' || rec2->mtext[1] != '0' || rec2->mtext[2] != '0'){
-		printTestStatus(2, 0);
-	}
-	else if (rec3->mtext[0] != '2' || rec3->mtext[1] != '0' || rec3->mtext[2] != '0'){
-		printTestStatus(2, 0);
-	}
-	else if (rec4->mtext[0] != '2' || rec4->mtext[1] != '0' || rec4->mtext[2] != '1'){
+	int h1 = delayed_send(4, msg, 200);
+	int h2 = delayed_send(4, msg2, 100);
+	int h3 = delayed_send(4, msg3, 50);
+	int h4 = delayed_send(4, msg4, 201);
+	
+	if (h1 == RTX_ERR || h2 == RTX_ERR || h3 == RTX_ERR || h4 == RTX_ERR){
+		//out of timers, take back whatever did get one
+		release_memory_block(h1 == RTX_ERR ? msg : cancel_delayed_send(h1));
+		release_memory_block(h2 == RTX_ERR ? msg2 : cancel_delayed_send(h2));
+		release_memory_block(h3 == RTX_ERR ? msg3 : cancel_delayed_send(h3));
+		release_memory_block(h4 == RTX_ERR ? msg4 : cancel_delayed_send(h4));
 		printTestStatus(2, 0);
 	}
 	else {
-		printTestStatus(2, 1);
+		MSG_BUF* rec = receive_message(&sender);
+		MSG_BUF* rec2 = receive_message(&sender);
+		MSG_BUF* rec3 = receive_message(&sender);
+		MSG_BUF* rec4 = receive_message(&sender);
+		
+		if (rec->mtext[0] != '5' || rec->mtext[1] != '0'){
+			printTestStatus(2, 0);
+		}
+		else if (rec2->mtext[0] != '1' || rec2->mtext[1] != '0' || rec2->mtext[2] != '0'){
+			printTestStatus(2, 0);
+		}
+		else if (rec3->mtext[0] != '2' || rec3->mtext[1] != '0' || rec3->mtext[2] != '0'){
+			printTestStatus(2, 0);
+		}
+		else if (rec4->mtext[0] != '2' || rec4->mtext[1] != '0' || rec4->mtext[2] != '1'){
+			printTestStatus(2, 0);
+		}
+		else {
+			printTestStatus(2, 1);
+		}
+		
+		release_memory_block(rec);
+		release_memory_block(rec2);
+		release_memory_block(rec3);
+		release_memory_block(rec4);
+	}
+	
+	//test 5: proc2 waits on proc3, so a reply from here must fail
+	while (!requestReceived) {
+		release_processor();
+	}
+	
+	msg = (MSG_BUF*) request_memory_block();
+	replyWrongServer = reply(PID_P2, msg) == RTX_ERR;
+	release_memory_block(msg);
+	wrongServerTried = 1;
+	
+	//test 6: fill proc5's mailbox, then send to it while it is full
+	while (!limitSet) {
+		release_processor();
 	}
 	
-	release_memory_block(rec);
-	release_memory_block(rec2);
-	release_memory_block(rec3);
-	release_memory_block(rec4);
+	msg = (MSG_BUF*) request_memory_block();
+	msg->mtype = DEFAULT;
+	msg->mtext[0] = '1';
+	msg->mtext[1] = '\0';
+	send_message(PID_P5, msg);
+	
+	msg = (MSG_BUF*) request_memory_block();
+	msg->mtype = DEFAULT;
+	msg->mtext[0] = '2';
+	msg->mtext[1] = '\0';
+	if (try_send_message(PID_P5, msg) == RTX_ERR) {
+		trySendFailed = 1;
+		send_message(PID_P5, msg);
+	}
+	secondSent = 1;
 	
 	while (1) {
 		release_processor();
@@ -353,13 +536,98 @@ void proc5(void) {
 	
 	release_memory_block(msg3);
 	
+	//test 6: a sender to a full mailbox waits in BLK_SEND until there is room
+	set_mailbox_limit(PID_P5, 1);
+	limitSet = 1;
+	
+	while (!secondSent && !inState(PID_P4, BLK_SEND)) {
+		release_processor();
+	}
+	int blocked = !secondSent;
+	
+	MSG_BUF* first = (MSG_BUF*) receive_message(&sender);
+	
+	//proc4 is ready again, let it finish the send
+	while (!secondSent) {
+		release_processor();
+	}
+	MSG_BUF* second = (MSG_BUF*) receive_message(&sender);
+	
+	if (!blocked || !trySendFailed){
+		printTestStatus(6, 0);
+	}
+	else if (first->mtext[0] != '1' || second->mtext[0] != '2' || sender != PID_P4){
+		printTestStatus(6, 0);
+	}
+	else {
+		printTestStatus(6, 1);
+	}
+	
+	set_mailbox_limit(PID_P5, 0);
+	release_memory_block(first);
+	release_memory_block(second);
+	
 	while (1) {		
 		release_processor();
 	}
 }
 
+/**
+ * @brief: delayed messages due either side of the 32-bit tick wrap arrive in
+ *         order. Needs a build with TIMER_INITIAL_COUNT just below the wrap,
+ *         e.g. 0xFFFFF000, otherwise it waits 49 days for it.
+ */
 void proc6(void){
-	while(1){
+	
+	while (1){
+		release_processor();
+	}
+	
+	while (testsRan < 3 || !ready){
+		release_processor();
+	}
+	
+	int sender;
+	
+	MSG_BUF* after = (MSG_BUF*) request_memory_block();
+	after->mtype = DEFAULT;
+	after->mtext[0] = 'a';
+	after->mtext[1] = '\0';
+	
+	MSG_BUF* before = (MSG_BUF*) request_memory_block();
+	before->mtype = DEFAULT;
+	before->mtext[0] = 'b';
+	before->mtext[1] = '\0';
+	
+	//sent first, due last
+	int h1 = delayed_send_at(6, after, 0x10);
+	int h2 = delayed_send_at(6, before, (int) 0xFFFFFFF0);
+	
+	if (h1 == RTX_ERR || h2 == RTX_ERR){
+		//out of timers, take back whatever did get one
+		release_memory_block(h1 == RTX_ERR ? after : cancel_delayed_send(h1));
+		release_memory_block(h2 == RTX_ERR ? before : cancel_delayed_send(h2));
+		printTestStatus(4, 0);
+	}
+	else {
+		MSG_BUF* rec = receive_message(&sender);
+		MSG_BUF* rec2 = receive_message(&sender);
+		
+		if (rec->mtext[0] != 'b' || rec2->mtext[0] != 'a'){
+			printTestStatus(4, 0);
+		}
+		else if (clock_ticks() < 0x100000010ULL || (U32) get_system_time() < 0x10){
+			printTestStatus(4, 0);
+		}
+		else {
+			printTestStatus(4, 1);
+		}
+		
+		release_memory_block(rec);
+		release_memory_block(rec2);
+	}
+	
+	while (1) {
 		release_processor();
 	}
 }
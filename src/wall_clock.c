@@ -1,6 +1,5 @@
 #include "rtx.h"
 #include "uart_polling.h"
-#define TIME_DELAY 1000
 
 extern char* nextNonWhitespace(char* cur);
 extern int charToInt(char c);
@@ -46,77 +45,45 @@ void timeToStr(int time, char* dest) {
     dest[10] = '\0';
 }
 
+void printTime(int time) {
+    MSG_BUF* printMsg = (MSG_BUF*) request_memory_block();
+    printMsg->mtype = DEFAULT;
+    timeToStr(time, printMsg->mtext);
+    send_message(PID_CRT, printMsg);
+}
+
 void wallClockProc() {
     MSG_BUF* msg = (MSG_BUF*) request_memory_block();
     msg->mtype = KCD_REG;
 		copyStr("%W", msg->mtext);
     send_message(PID_KCD, msg);
 
-    int time = 0;
-    char incrementorID = 0;
-
+    /* The RTC keeps the time and its seconds interrupt prints it, we only set it */
     while (1) {
         int sender_id;
+        int time;
         MSG_BUF* msg = (MSG_BUF*) receive_message(&sender_id);
         char command = msg->mtext[2];
 
-        if (command == 'R') {
-            incrementorID++;
-            time = 0;
-            msg->mtype = DEFAULT;
-            msg->mtext[0] = '%';
-            msg->mtext[1] = 'W';
-            msg->mtext[2] = 'I';
-            msg->mtext[3] = '\0';
-            msg->mtext[4] = incrementorID;
-            delayed_send(PID_CLOCK, msg, TIME_DELAY);
-
-            MSG_BUF* printMsg = (MSG_BUF*) request_memory_block();
-            printMsg->mtype = DEFAULT;
-            timeToStr(time, printMsg->mtext);
-            send_message(PID_CRT, printMsg);
-        }
-        else if (command == 'I') {
-            if (msg->mtext[4] == incrementorID) {
-                time++;
-                delayed_send(PID_CLOCK, msg, TIME_DELAY);
-
-                MSG_BUF* printMsg = (MSG_BUF*) request_memory_block();
-                printMsg->mtype = DEFAULT;
-                timeToStr(time, printMsg->mtext);
-                send_message(PID_CRT, printMsg);
+        if (command == 'R' || command == 'S') {
+            if (command == 'S') {
+                char* timeStart = nextNonWhitespace(msg->mtext + 3);
+                if (timeStart == NULL) {
+                    release_memory_block((void*) msg);
+                    continue;
+                }
+                time = parseTime(timeStart);
             }
             else {
-                release_memory_block((void*) msg);
+                time = 0;
             }
-        }
-        else if (command == 'S') {
-            incrementorID++;
-            char* timeStart = nextNonWhitespace(msg->mtext + 3);
-						if (timeStart == NULL) {
-							release_memory_block((void*) msg);
-							continue;
-						}
-            time = parseTime(timeStart);
-            msg->mtype = DEFAULT;
-            msg->mtext[0] = '%';
-            msg->mtext[1] = 'W';
-            msg->mtext[2] = 'I';
-            msg->mtext[3] = '\0';
-            msg->mtext[4] = incrementorID;
-            delayed_send(PID_CLOCK, msg, TIME_DELAY);
 
-            MSG_BUF* printMsg = (MSG_BUF*) request_memory_block();
-            printMsg->mtype = DEFAULT;
-            timeToStr(time, printMsg->mtext);
-            send_message(PID_CRT, printMsg);
+            set_wall_clock(time);
+            printTime(time);
         }
         else if (command == 'T') {
-            incrementorID++;
-            release_memory_block((void*) msg);
-        }
-        else {
-            release_memory_block((void*) msg);
+            stop_wall_clock();
         }
+        release_memory_block((void*) msg);
     }
 }